@@ -0,0 +1,222 @@
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "../Core/6502.hpp"
+#include "../Core/Controller.hpp"
+#include "../Core/Mapper/Mapper.hpp"
+#include "../Core/PPU.hpp"
+#include "../Core/ROM.hpp"
+
+//Headless benchmark: runs a ROM for a number of frames as fast as possible
+//and reports where the time went
+
+static const char *USAGE =
+    "Usage: mednes-bench <path/to/rom> [-frames N] [-input file] [-json] [-blockcache] [-jit] [-idleskip] [-dots] [-indexed] [-frameskip N]\n"
+    "  -input   one byte of buttons per frame, bit n is Controller::Button n\n";
+
+//A JSON string literal, quotes included. Paths can hold quotes, backslashes
+//(every Windows path) and control characters.
+static std::string jsonString(const std::string &text) {
+    std::string quoted = "\"";
+
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (c < 0x20) {
+            char escape[7];
+            snprintf(escape, sizeof(escape), "\\u%04x", c);
+            quoted += escape;
+        } else {
+            quoted += c;
+        }
+    }
+
+    return quoted + "\"";
+}
+
+//A whole number from min to max, false for anything else
+static bool parseNumber(const char *text, long min, long max, int &value) {
+    char *end;
+    errno = 0;
+    long number = strtol(text, &end, 10);
+
+    if (end == text || *end != '\0' || errno == ERANGE || number < min || number > max) {
+        return false;
+    }
+
+    value = number;
+    return true;
+}
+
+int main(int argc, char **argv) {
+    std::string romPath = "";
+    std::string inputPath = "";
+    int frames = 600;
+    bool json = false;
+    bool blockCache = false;
+    bool jit = false;
+    bool idleSkip = false;
+    bool dots = false;
+    bool indexed = false;
+    int drawInterval = 1;
+
+    if (argc < 2) {
+        std::cout << USAGE;
+        return 1;
+    }
+
+    romPath = argv[1];
+
+    for (int i = 2; i < argc; i++) {
+        std::string flag = argv[i];
+
+        if (flag == "-frames" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], 1, INT_MAX, frames)) {
+                std::cout << "-frames needs a number of frames above 0.\n"
+                          << USAGE;
+                return 1;
+            }
+        } else if (flag == "-input" && i + 1 < argc) {
+            inputPath = argv[++i];
+        } else if (flag == "-json") {
+            json = true;
+        } else if (flag == "-blockcache") {
+            blockCache = true;
+        } else if (flag == "-jit") {
+            jit = true;
+        } else if (flag == "-idleskip") {
+            idleSkip = true;
+        } else if (flag == "-dots") {
+            dots = true;
+        } else if (flag == "-indexed") {
+            indexed = true;
+        } else if (flag == "-frameskip" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], 0, INT_MAX, drawInterval)) {
+                std::cout << "-frameskip needs a number of frames, 0 or above.\n"
+                          << USAGE;
+                return 1;
+            }
+        } else {
+            std::cout << "Unkown option '" << flag << "'.\n"
+                      << USAGE;
+            return 1;
+        }
+    }
+
+    if (!std::ifstream(romPath)) {
+        std::cout << "Could not open ROM '" << romPath << "'." << std::endl;
+        return 1;
+    }
+
+    std::ifstream input;
+
+    if (!inputPath.empty()) {
+        input.open(inputPath, std::ios::binary);
+
+        if (!input) {
+            std::cout << "Could not open input file '" << inputPath << "'." << std::endl;
+            return 1;
+        }
+    }
+
+    MedNES::ROM rom;
+    rom.open(romPath);
+    MedNES::Mapper *mapper = rom.getMapper();
+
+    if (mapper == NULL) {
+        std::cout << "Could not read ROM or unknown mapper." << std::endl;
+        return 1;
+    }
+
+    auto ppu = MedNES::PPU(mapper);
+    ppu.setScanlineRendering(!dots);
+    ppu.setPixelFormat(indexed ? MedNES::PixelFormat::INDEXED8 : MedNES::PixelFormat::ARGB8888);
+    ppu.setDrawInterval(drawInterval);
+    MedNES::Controller controller;
+    MedNES::CPU6502 cpu(mapper, &ppu, &controller);
+    cpu.setBlockCache(blockCache);
+
+    if (jit && !cpu.setJit(true)) {
+        std::cerr << "JIT not available, using the interpreter." << std::endl;
+        jit = false;
+    }
+
+    cpu.setIdleLoopSkip(idleSkip);
+    cpu.setProfiling(true);
+    cpu.reset();
+
+    auto t1 = std::chrono::steady_clock::now();
+
+    for (int frame = 0; frame < frames; frame++) {
+        char buttons = 0;
+
+        //all buttons are released once the recording runs out
+        if (input.is_open() && !input.get(buttons)) {
+            buttons = 0;
+        }
+
+        controller.setButtons((MedNES::u8)buttons);
+
+        while (!ppu.generateFrame) {
+            cpu.run();
+        }
+
+        ppu.generateFrame = false;
+    }
+
+    auto t2 = std::chrono::steady_clock::now();
+
+    MedNES::u64 total = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count();
+    const MedNES::SubsystemTimes &times = cpu.getSubsystemTimes();
+    MedNES::u64 cpuTime = total - std::min(total, times.ppu + times.mapper);
+    double seconds = total / 1e9;
+    MedNES::u64 instructions = cpu.getInstructionCount();
+    const char *mode = jit ? "jit" : (blockCache ? "blockcache" : "interpreter");
+    double skippedPerFrame = frames > 0 ? (double)cpu.getSkippedCycles() / frames : 0;
+
+    if (json) {
+        printf("{\n");
+        printf("  \"rom\": %s,\n", jsonString(romPath).c_str());
+        printf("  \"crc32\": \"%08X\",\n", rom.getInfo().crc32);
+        printf("  \"mode\": \"%s\",\n", mode);
+        printf("  \"idle_skip\": %s,\n", idleSkip ? "true" : "false");
+        printf("  \"ppu_renderer\": \"%s\",\n", dots ? "dot" : "scanline");
+        printf("  \"output\": \"%s\",\n", indexed ? "indexed8" : "argb8888");
+        printf("  \"draw_interval\": %d,\n", drawInterval);
+        printf("  \"frames\": %d,\n", frames);
+        printf("  \"seconds\": %.6f,\n", seconds);
+        printf("  \"fps\": %.2f,\n", frames / seconds);
+        printf("  \"instructions\": %llu,\n", (unsigned long long)instructions);
+        printf("  \"ips\": %.0f,\n", instructions / seconds);
+        printf("  \"skipped_cycles_per_frame\": %.1f,\n", skippedPerFrame);
+        printf("  \"ns\": {\"cpu\": %llu, \"ppu\": %llu, \"mapper\": %llu, \"apu\": 0}\n",
+               (unsigned long long)cpuTime, (unsigned long long)times.ppu, (unsigned long long)times.mapper);
+        printf("}\n");
+    } else {
+        printf("%s (%s%s%s%s)\n", romPath.c_str(), mode, idleSkip ? ", idle skip" : "", dots ? ", dot renderer" : "",
+               indexed ? ", indexed output" : "");
+
+        if (drawInterval != 1) {
+            printf("  drawn         1 frame in %d\n", drawInterval);
+        }
+
+        printf("  frames        %d in %.3f s, %.2f fps\n", frames, seconds, frames / seconds);
+        printf("  instructions  %llu, %.2f M/s\n", (unsigned long long)instructions, instructions / seconds / 1e6);
+        printf("  idle skipped  %.1f CPU cycles per frame\n", skippedPerFrame);
+        printf("  cpu           %5.1f%%\n", 100.0 * cpuTime / total);
+        printf("  ppu           %5.1f%%\n", 100.0 * times.ppu / total);
+        printf("  mapper        %5.1f%%\n", 100.0 * times.mapper / total);
+        printf("  apu           %5.1f%%\n", 0.0);
+    }
+
+    return 0;
+}
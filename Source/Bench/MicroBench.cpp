@@ -0,0 +1,483 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../Core/6502.hpp"
+#include "../Core/Controller.hpp"
+#include "../Core/Mapper/CNROM.hpp"
+#include "../Core/Mapper/MMC1.hpp"
+#include "../Core/Mapper/NROM.hpp"
+#include "../Core/Mapper/UnROM.hpp"
+#include "../Core/PPU.hpp"
+#include "../Core/SpriteEval.hpp"
+
+//Microbenchmarks for the core's hot kernels. Every kernel reports the best
+//nanoseconds per operation over several runs, -compare fails when one of them
+//got slower than a saved -json run by more than the threshold, -json or not,
+//or when a kernel of the saved run no longer runs.
+
+namespace MedNES {
+
+static volatile u32 sink;
+
+class MicroBench {
+   public:
+    std::string filter;
+    std::map<std::string, double> results;
+    std::vector<std::string> order;
+
+    void run();
+
+   private:
+    static const int REPEATS = 7;
+    static constexpr double MIN_RUN_SECONDS = 0.01;
+
+    std::vector<u8> prg = std::vector<u8>(256 * 1024);
+    std::vector<u8> smallPrg = std::vector<u8>(32 * 1024);
+    std::vector<u8> chr = std::vector<u8>(128 * 1024);
+
+    //Run batch until it takes long enough to time, opsPerBatch operations each
+    template <typename Batch>
+    void measure(const std::string &name, int opsPerBatch, Batch batch);
+
+    void cpuKernels();
+    void ppuKernels();
+    void mapperKernels();
+    void stateKernels();
+
+    void cpuKernel(const std::string &name, std::vector<u8> code);
+    void mapperKernel(const std::string &name, Mapper &mapper);
+};
+
+template <typename Batch>
+void MicroBench::measure(const std::string &name, int opsPerBatch, Batch batch) {
+    if (name.find(filter) == std::string::npos) {
+        return;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    long batches = 1;
+
+    //warm up and find a batch count that runs for MIN_RUN_SECONDS
+    while (true) {
+        auto start = Clock::now();
+
+        for (long i = 0; i < batches; i++) {
+            batch();
+        }
+
+        if (std::chrono::duration<double>(Clock::now() - start).count() >= MIN_RUN_SECONDS) {
+            break;
+        }
+
+        batches *= 2;
+    }
+
+    double best = 0;
+
+    for (int repeat = 0; repeat < REPEATS; repeat++) {
+        auto start = Clock::now();
+
+        for (long i = 0; i < batches; i++) {
+            batch();
+        }
+
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (batches * opsPerBatch);
+
+        if (repeat == 0 || ns < best) {
+            best = ns;
+        }
+    }
+
+    results[name] = best;
+    order.push_back(name);
+}
+
+void MicroBench::run() {
+    for (size_t i = 0; i < prg.size(); i++) {
+        prg[i] = i * 7;
+    }
+
+    std::copy(prg.begin(), prg.begin() + smallPrg.size(), smallPrg.begin());
+
+    for (size_t i = 0; i < chr.size(); i++) {
+        chr[i] = i * 13;
+    }
+
+    cpuKernels();
+    ppuKernels();
+    mapperKernels();
+    stateKernels();
+}
+
+//One instruction per operation, the code sits at $0200 in RAM
+void MicroBench::cpuKernel(const std::string &name, std::vector<u8> code) {
+    NROM mapper(Cartridge::fromBytes(smallPrg, chr, 0));
+    std::unique_ptr<PPU> ppu(new PPU(&mapper));
+    Controller controller;
+    std::unique_ptr<CPU6502> cpu(new CPU6502(&mapper, ppu.get(), &controller));
+
+    for (size_t i = 0; i < code.size(); i++) {
+        cpu->write(0x0200 + i, code[i]);
+    }
+
+    //($10),Y points at $0300
+    cpu->write(0x0010, 0x00);
+    cpu->write(0x0011, 0x03);
+
+    measure(name, 256, [&]() {
+        for (int i = 0; i < 256; i++) {
+            cpu->setProgramCounter(0x0200);
+            cpu->executeInstruction(code[0]);
+        }
+    });
+}
+
+void MicroBench::cpuKernels() {
+    cpuKernel("cpu/implied", {0xE8});               //INX
+    cpuKernel("cpu/immediate", {0xA9, 0x10});       //LDA #$10
+    cpuKernel("cpu/zeropage", {0xA5, 0x10});        //LDA $10
+    cpuKernel("cpu/zeropage_x", {0xB5, 0x10});      //LDA $10,X
+    cpuKernel("cpu/absolute", {0xAD, 0x00, 0x03});  //LDA $0300
+    cpuKernel("cpu/absolute_x", {0xBD, 0x00, 0x03});
+    cpuKernel("cpu/indirect_y", {0xB1, 0x10});      //LDA ($10),Y
+    cpuKernel("cpu/rom_read", {0xAD, 0x00, 0x80});  //LDA $8000
+    cpuKernel("cpu/store", {0x8D, 0x00, 0x03});     //STA $0300
+    cpuKernel("cpu/read_modify_write", {0xE6, 0x10});
+    cpuKernel("cpu/branch", {0xD0, 0x00});          //BNE
+    cpuKernel("cpu/stack", {0x48});                 //PHA
+    cpuKernel("cpu/jump", {0x4C, 0x00, 0x02});      //JMP $0200
+}
+
+void MicroBench::ppuKernels() {
+    NROM mapper(Cartridge::fromBytes(smallPrg, chr, 0));
+    std::unique_ptr<PPU> ppu(new PPU(&mapper));
+
+    //show background and sprites
+    ppu->write(0x2001, 0x18);
+
+    //One dot per operation
+    measure("ppu/tick_visible", DOTS_PER_SCANLINE, [&]() {
+        ppu->scanLine = 100;
+        ppu->dot = 0;
+        ppu->pixelIndex = 100 * 256;
+
+        for (int i = 0; i < DOTS_PER_SCANLINE; i++) {
+            ppu->tick();
+        }
+    });
+
+    measure("ppu/render_scanline", DOTS_PER_SCANLINE, [&]() {
+        ppu->scanLine = 100;
+        ppu->dot = 0;
+        ppu->pixelIndex = 100 * 256;
+        ppu->renderScanline();
+    });
+
+    measure("ppu/tick_vblank", DOTS_PER_SCANLINE, [&]() {
+        ppu->scanLine = 245;
+        ppu->dot = 0;
+
+        for (int i = 0; i < DOTS_PER_SCANLINE; i++) {
+            ppu->tick();
+        }
+    });
+
+    //One pixel per operation, the sprites are rearmed every 8 pixels
+    for (int sprites : {0, 1, 8}) {
+        ppu->spriteRenderEntities.clear();
+
+        for (int i = 0; i < sprites; i++) {
+            SpriteRenderEntity sprite;
+            sprite.lo = 0xAA;
+            sprite.hi = 0x55;
+            sprite.attr = i & 3;
+            sprite.counter = 0;
+            sprite.id = i;
+            sprite.flipHorizontally = i & 1;
+            sprite.flipVertically = false;
+            TileRow row = TileCache::decode(sprite.lo, sprite.hi);
+            sprite.pixels = sprite.flipHorizontally ? row.flipped : row.pixels;
+            ppu->spriteRenderEntities.push_back(sprite);
+        }
+
+        measure("ppu/emit_pixel_" + std::to_string(sprites) + "_sprites", 256, [&]() {
+            ppu->scanLine = 100;
+            ppu->dot = 100;
+            ppu->pixelIndex = 100 * 256;
+
+            for (int i = 0; i < 256; i += 8) {
+                for (auto &sprite : ppu->spriteRenderEntities) {
+                    sprite.shifted = 0;
+                }
+
+                for (int pixel = 0; pixel < 8; pixel++) {
+                    ppu->emitPixel();
+                }
+            }
+        });
+    }
+
+    //One pattern row per operation, through the tile cache
+    measure("ppu/tile_row", 4096, [&]() {
+        u32 sum = 0;
+
+        for (int i = 0; i < 4096; i++) {
+            sum += ppu->tileCache.row(i * 2).pixels;
+        }
+
+        sink = sum;
+    });
+
+    //One pixel per operation, a line with a sprite every other tile
+    LineLayers layers;
+    u8 indices[256];
+
+    for (int i = 0; i < 256; i++) {
+        layers.background[i] = chr[i] & 15;
+        layers.sprite[i] = (i & 8) ? 0x10 | (chr[i + 256] & 15) : 0;
+        layers.spriteFlags[i] = chr[i + 512] & 1;
+    }
+
+    measure(std::string("ppu/compose_line_") + compositorName(), 256, [&]() {
+        sink = composeLine(layers, true, true, indices);
+    });
+
+    measure("ppu/compose_line_scalar", 256, [&]() {
+        sink = composeLineScalar(layers, true, true, indices);
+    });
+
+    //One pixel per operation, a line of colour indices to ARGB
+    u32 colors[64];
+    u32 pixels[256];
+
+    for (int i = 0; i < 64; i++) {
+        colors[i] = 0xFF000000 | (i * 0x040404);
+    }
+
+    measure("ppu/expand_indices", 256, [&]() {
+        expandIndices(&chr[2048], 256, colors, pixels);
+        sink = pixels[sink & 0xFF];
+    });
+
+    //One line per operation, Y test of all 64 sprites in OAM
+    const u8 *oam = &chr[1024];
+
+    measure(std::string("ppu/sprite_eval_") + spriteEvalName(), 1, [&]() {
+        sink = spritesOnLine(oam, sink & 0xFF, 16);
+    });
+
+    measure("ppu/sprite_eval_scalar", 1, [&]() {
+        sink = spritesOnLineScalar(oam, sink & 0xFF, 16);
+    });
+
+    //One nametable read per operation
+    const char *mirroringNames[] = {"horizontal", "vertical", "single_lower", "single_upper"};
+
+    for (int mirroring = 0; mirroring < 4; mirroring++) {
+        NROM mirrored(Cartridge::fromBytes(smallPrg, chr, mirroring));
+        std::unique_ptr<PPU> mirroredPPU(new PPU(&mirrored));
+
+        measure(std::string("ppu/ppuread_") + mirroringNames[mirroring], 4096, [&]() {
+            u32 sum = 0;
+
+            for (int i = 0; i < 4096; i++) {
+                sum += mirroredPPU->ppuread(0x2000 + i);
+            }
+
+            sink = sum;
+        });
+    }
+}
+
+//One read per operation
+void MicroBench::mapperKernel(const std::string &name, Mapper &mapper) {
+    measure("mapper/" + name + "_read", 4096, [&]() {
+        u32 sum = 0;
+
+        for (int i = 0; i < 4096; i++) {
+            sum += mapper.read(0x8000 + ((i * 97) & 0x7FFF));
+        }
+
+        sink = sum;
+    });
+
+    measure("mapper/" + name + "_ppuread", 4096, [&]() {
+        u32 sum = 0;
+
+        for (int i = 0; i < 4096; i++) {
+            sum += mapper.ppuread((i * 97) & 0x1FFF);
+        }
+
+        sink = sum;
+    });
+}
+
+void MicroBench::mapperKernels() {
+    NROM nrom(Cartridge::fromBytes(smallPrg, chr, 0));
+    UnROM unrom(Cartridge::fromBytes(prg, chr, 0));
+    CNROM cnrom(Cartridge::fromBytes(smallPrg, chr, 0));
+    MMC1 mmc1(Cartridge::fromBytes(prg, chr, 0));
+
+    mapperKernel("nrom", nrom);
+    mapperKernel("unrom", unrom);
+    mapperKernel("cnrom", cnrom);
+    mapperKernel("mmc1", mmc1);
+}
+
+//One whole machine save or load per operation
+void MicroBench::stateKernels() {
+    MMC1 mapper(Cartridge::fromBytes(prg, chr, 0));
+    std::unique_ptr<PPU> ppu(new PPU(&mapper));
+    Controller controller;
+    std::unique_ptr<CPU6502> cpu(new CPU6502(&mapper, ppu.get(), &controller));
+    std::unique_ptr<SaveState> state(new SaveState());
+
+    measure("state/save", 1, [&]() {
+        cpu->saveState(*state);
+    });
+
+    measure("state/load", 1, [&]() {
+        cpu->loadState(*state);
+    });
+}
+
+};  //namespace MedNES
+
+static const char *USAGE =
+    "Usage: mednes-microbench [-filter text] [-json] [-compare baseline.json] [-threshold percent]\n";
+
+//Reads "name": value pairs, as written by -json
+static bool readBaseline(const std::string &path, std::map<std::string, double> &baseline) {
+    std::ifstream in(path);
+
+    if (!in) {
+        return false;
+    }
+
+    std::stringstream text;
+    text << in.rdbuf();
+    std::string json = text.str();
+    size_t pos = 0;
+
+    while ((pos = json.find('"', pos)) != std::string::npos) {
+        size_t end = json.find('"', pos + 1);
+
+        if (end == std::string::npos) {
+            break;
+        }
+
+        std::string name = json.substr(pos + 1, end - pos - 1);
+        size_t value = json.find_first_not_of(" \t\r\n:", end + 1);
+        pos = end + 1;
+
+        if (value != std::string::npos && (isdigit(json[value]) || json[value] == '.')) {
+            baseline[name] = strtod(json.c_str() + value, nullptr);
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv) {
+    MedNES::MicroBench bench;
+    std::string comparePath = "";
+    double threshold = 10;
+    bool json = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string flag = argv[i];
+
+        if (flag == "-filter" && i + 1 < argc) {
+            bench.filter = argv[++i];
+        } else if (flag == "-json") {
+            json = true;
+        } else if (flag == "-compare" && i + 1 < argc) {
+            comparePath = argv[++i];
+        } else if (flag == "-threshold" && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else {
+            std::cout << "Unkown option '" << flag << "'.\n"
+                      << USAGE;
+            return 1;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+
+    if (!comparePath.empty() && !readBaseline(comparePath, baseline)) {
+        std::cout << "Could not open baseline '" << comparePath << "'." << std::endl;
+        return 1;
+    }
+
+    bench.run();
+
+    //the comparison sets the exit code in both output modes, with -json the
+    //regressions go to stderr so stdout stays a baseline
+    int regressions = 0;
+
+    if (json) {
+        printf("{\n  \"kernels\": {\n");
+    }
+
+    for (size_t i = 0; i < bench.order.size(); i++) {
+        const std::string &name = bench.order[i];
+        double ns = bench.results[name];
+        auto base = baseline.find(name);
+        double change = base != baseline.end() ? (ns / base->second - 1) * 100 : 0;
+        bool regressed = base != baseline.end() && change > threshold;
+        regressions += regressed;
+
+        if (json) {
+            printf("    \"%s\": %.3f%s\n", name.c_str(), ns, i + 1 < bench.order.size() ? "," : "");
+
+            if (regressed) {
+                fprintf(stderr, "%s regressed by %+.1f%% (baseline %.3f ns, now %.3f ns)\n", name.c_str(), change,
+                        base->second, ns);
+            }
+        } else if (comparePath.empty()) {
+            printf("%-30s %9.3f ns\n", name.c_str(), ns);
+        } else if (base == baseline.end()) {
+            printf("%-30s %9.3f ns   (not in baseline)\n", name.c_str(), ns);
+        } else {
+            printf("%-30s %9.3f ns   baseline %9.3f ns   %+6.1f%%%s\n", name.c_str(), ns, base->second, change,
+                   regressed ? "   REGRESSED" : "");
+        }
+    }
+
+    if (json) {
+        printf("  }\n}\n");
+    }
+
+    //a kernel renamed or dropped since the baseline fails the comparison too,
+    //unless -filter left it out
+    FILE *report = json ? stderr : stdout;
+    int missing = 0;
+
+    for (const auto &base : baseline) {
+        if (bench.results.count(base.first) == 0 && base.first.find(bench.filter) != std::string::npos) {
+            fprintf(report, "%s is in the baseline but did not run\n", base.first.c_str());
+            missing++;
+        }
+    }
+
+    if (regressions > 0) {
+        fprintf(report, "%d kernel(s) regressed by more than %.1f%%\n", regressions, threshold);
+    }
+
+    if (missing > 0) {
+        fprintf(report, "%d baseline kernel(s) did not run\n", missing);
+    }
+
+    return regressions > 0 || missing > 0 ? 1 : 0;
+}
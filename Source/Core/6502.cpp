@@ -1,25 +1,416 @@
 #include "6502.hpp"
 
 #include <assert.h>
+#include <string.h>
+
+#include <algorithm>
 
 namespace MedNES {
 
+#ifdef MEDNES_HAS_JIT
+CPU6502::CPU6502(Mapper *mapper, PPU *ppu, Controller *controller) : mapper(mapper), ppu(ppu), controller(controller), jit(this) {
+#else
+CPU6502::CPU6502(Mapper *mapper, PPU *ppu, Controller *controller) : mapper(mapper), ppu(ppu), controller(controller) {
+#endif
+    //2kb internal RAM mirrored up to $2000
+    for (u16 mirror = 0; mirror < 0x2000; mirror += 0x800) {
+        pageTable.map(mirror, 0x800, ram.data(), ram.data());
+    }
+
+    mapper->setPageTable(&pageTable);
+    ppu->scheduleEvents(scheduler);
+}
+
+//Execute instructions until the next scheduled event is due, then service it
+void CPU6502::run() {
+    if (blockCache.isEnabled()) {
+        do {
+            executeBlock();
+        } while (!scheduler.isDue());
+    } else {
+        do {
+            interpretInstruction();
+        } while (!scheduler.isDue());
+    }
+
+    serviceEvents();
+}
+
+//One instruction, or one block when the block cache is enabled
 void CPU6502::step() {
-    if (ppu->genNMI()) {
-        NMI();
-        cycle = 0;
+    if (blockCache.isEnabled()) {
+        executeBlock();
+    } else {
+        interpretInstruction();
     }
 
+    if (scheduler.isDue()) {
+        serviceEvents();
+    }
+}
+
+inline void CPU6502::interpretInstruction() {
     u8 instruction = fetchInstruction();
     executeInstruction(instruction);
     programCounter++;
+    instructions++;
+}
+
+void CPU6502::setBlockCache(bool enabled) {
+    if (enabled) {
+        blockCache.enable();
+    } else {
+        blockCache.disable();
+    }
+
+#ifdef MEDNES_HAS_JIT
+    if (enabled) {
+        jit.flush();
+    } else {
+        jit.disable();
+    }
+#endif
+
+    for (int page = 0; page < 256; page++) {
+        codeWatch[page] = false;
+    }
+}
+
+bool CPU6502::setJit(bool enabled) {
+#ifdef MEDNES_HAS_JIT
+    if (!enabled) {
+        jit.disable();
+        blockCache.dropNativeCode();
+        return false;
+    }
+
+    if (!blockCache.isEnabled()) {
+        setBlockCache(true);
+    }
+
+    return jit.enable();
+#else
+    (void)enabled;
+    return false;
+#endif
+}
+
+#ifdef MEDNES_HAS_JIT
+NativeBlock CPU6502::translate(Block &block) {
+    NativeBlock native = jit.compile(block);
+
+    if (native == nullptr) {
+        blockCache.dropNativeCode();
+        jit.flush();
+        native = jit.compile(block);
+    }
+
+    return native;
+}
+#endif
+
+//Run predecoded instructions until control flow, a due event, or a write
+//that changes the code or the banks under the block
+inline void CPU6502::executeBlock() {
+    const u8 *page = pageTable.read[programCounter >> 8];
+
+    if (page == nullptr) {
+        interpretInstruction();
+        return;
+    }
+
+    Block *block = blockCache.find(page + (programCounter & 0xFF));
+
+    if (block == nullptr) {
+        block = decodeBlock(page);
+
+        if (block == nullptr) {
+            interpretInstruction();
+            return;
+        }
+    }
+
+    blockAborted = false;
+
+#ifdef MEDNES_HAS_JIT
+    //only code that can't be written is translated
+    if (block->native == nullptr && jit.isEnabled() && ++block->runs == jit.hotThreshold &&
+        pageTable.write[programCounter >> 8] == nullptr) {
+        block->native = translate(*block);
+    }
+
+    if (block->native != nullptr) {
+        block->native(this);
+        return;
+    }
+#endif
+
+    for (int i = 0; i < block->count; i++) {
+        //opcode fetch, the byte itself was read when decoding
+        tick();
+        (this->*block->ops[i])();
+        programCounter++;
+        instructions++;
+
+        if (scheduler.isDue() || blockAborted) {
+            break;
+        }
+    }
+}
+
+static inline bool endsBlock(u8 opcode) {
+    //BRK, JSR, RTI, RTS, JMP and the relative branches
+    return opcode == 0x00 || opcode == 0x20 || opcode == 0x40 || opcode == 0x60 ||
+           opcode == 0x4C || opcode == 0x6C || (opcode & 0x1F) == 0x10;
+}
+
+//Only opcodes are taken from the page, operands are still read live, so the
+//last instruction may run over into the next page.
+Block *CPU6502::decodeBlock(const u8 *page) {
+    if (blockCache.isVolatile(page)) {
+        return nullptr;
+    }
+
+    int offset = programCounter & 0xFF;
+    Block *block = blockCache.allocate(page + offset, page);
+
+    while (block->count < Block::MAX_OPS) {
+        u8 opcode = page[offset];
+        int length = opcodeLengths[opcode];
+        block->ops[block->count++] = opcodeTable[opcode];
+        offset += length;
+
+        if (length == 0 || offset >= 256 || endsBlock(opcode)) {
+            break;
+        }
+    }
+
+    //code in RAM: watch every mirror of its page for writes
+    if (pageTable.write[programCounter >> 8] != nullptr) {
+        block->writable = true;
+
+        for (int i = 0; i < 256; i++) {
+            if (pageTable.read[i] == page) {
+                codeWatch[i] = true;
+            }
+        }
+    }
+
+    return block;
+}
+
+void CPU6502::codeWritten(u16 address) {
+    const u8 *page = pageTable.write[address >> 8];
+    blockCache.invalidatePage(page);
+
+    for (int i = 0; i < 256; i++) {
+        if (pageTable.read[i] == page) {
+            codeWatch[i] = false;
+        }
+    }
+
+    blockAborted = true;
+}
+
+void CPU6502::saveState(SaveState &state) {
+    state.magic = SaveState::MAGIC;
+    state.version = SaveState::VERSION;
+    state.size = sizeof(SaveState);
+    state.reserved = 0;
+
+    scheduler.saveState(state.cpu.scheduler);
+    state.cpu.instructions = instructions;
+    state.cpu.programCounter = programCounter;
+    state.cpu.accumulator = accumulator;
+    state.cpu.xRegister = xRegister;
+    state.cpu.yRegister = yRegister;
+    state.cpu.stackPointer = stackPointer;
+    state.cpu.statusRegister = statusRegister;
+    memcpy(state.cpu.ram, ram.data(), sizeof(state.cpu.ram));
+
+    ppu->saveState(state.ppu);
+    controller->saveState(state.controller);
+    mapper->saveState(state.mapper);
+}
+
+bool CPU6502::loadState(const SaveState &state) {
+    if (state.magic != SaveState::MAGIC || state.version != SaveState::VERSION || state.size != sizeof(SaveState)) {
+        return false;
+    }
+
+    //restores the banks and the page table
+    if (!mapper->loadState(state.mapper)) {
+        return false;
+    }
+
+    scheduler.loadState(state.cpu.scheduler);
+    instructions = state.cpu.instructions;
+    programCounter = state.cpu.programCounter;
+    accumulator = state.cpu.accumulator;
+    xRegister = state.cpu.xRegister;
+    yRegister = state.cpu.yRegister;
+    stackPointer = state.cpu.stackPointer;
+    statusRegister = state.cpu.statusRegister;
+    memcpy(ram.data(), state.cpu.ram, sizeof(state.cpu.ram));
+
+    ppu->loadState(state.ppu);
+    controller->loadState(state.controller);
+
+    //code decoded from RAM may no longer be there, ROM blocks stay valid
+    blockCache.invalidateWritable();
+
+    for (int page = 0; page < 256; page++) {
+        codeWatch[page] = false;
+    }
+
+    idleLoop = IdleLoop();
+
+    return true;
+}
+
+void CPU6502::setIdleLoopSkip(bool enabled) {
+    idleLoopSkip = enabled;
+    idleLoop = IdleLoop();
+}
+
+//Instructions that only read memory and change registers and flags
+static bool isIdleLoopOp(u8 opcode) {
+    switch (opcode) {
+        //LDA, LDX, LDY
+        case 0xA9: case 0xA5: case 0xB5: case 0xAD: case 0xBD: case 0xB9: case 0xA1: case 0xB1:
+        case 0xA2: case 0xA6: case 0xB6: case 0xAE: case 0xBE:
+        case 0xA0: case 0xA4: case 0xB4: case 0xAC: case 0xBC:
+        //CMP, CPX, CPY, BIT
+        case 0xC9: case 0xC5: case 0xD5: case 0xCD: case 0xDD: case 0xD9: case 0xC1: case 0xD1:
+        case 0xE0: case 0xE4: case 0xEC:
+        case 0xC0: case 0xC4: case 0xCC:
+        case 0x24: case 0x2C:
+        //AND, ORA, EOR
+        case 0x29: case 0x25: case 0x35: case 0x2D: case 0x3D: case 0x39: case 0x21: case 0x31:
+        case 0x09: case 0x05: case 0x15: case 0x0D: case 0x1D: case 0x19: case 0x01: case 0x11:
+        case 0x49: case 0x45: case 0x55: case 0x4D: case 0x5D: case 0x59: case 0x41: case 0x51:
+        //transfers, CLC, SEC, CLV, CLD, SED, NOP
+        case 0xAA: case 0xA8: case 0x8A: case 0x98: case 0xBA: case 0x9A:
+        case 0x18: case 0x38: case 0xB8: case 0xD8: case 0xF8: case 0xEA:
+            return true;
+        default:
+            return false;
+    }
+}
+
+//Called when a branch or JMP at from goes back to target
+void CPU6502::idleLoopJump(u16 from, u16 target) {
+    if (from - target > MAX_IDLE_LOOP_BYTES) {
+        idleLoop.armed = false;
+        return;
+    }
+
+    if (idleLoop.armed && idleLoop.start == target && !idleLoop.sideEffects &&
+        idleLoop.accumulator == accumulator && idleLoop.xRegister == xRegister && idleLoop.yRegister == yRegister &&
+        idleLoop.stackPointer == stackPointer && idleLoop.statusRegister == statusRegister) {
+        skipIdleLoop();
+    } else if (!(idleLoop.armed && idleLoop.start == target)) {
+        if (idleLoop.rejected == target || !isIdleLoopBody(target, from)) {
+            idleLoop.armed = false;
+            idleLoop.rejected = target;
+            return;
+        }
+    }
+
+    armIdleLoop(target);
+}
+
+//The instructions from start must end exactly at the jump at end
+bool CPU6502::isIdleLoopBody(u16 start, u16 end) {
+    u16 address = start;
+
+    while (address < end) {
+        const u8 *page = pageTable.read[address >> 8];
+
+        if (page == nullptr || !isIdleLoopOp(page[address & 0xFF])) {
+            return false;
+        }
+
+        address += opcodeLengths[page[address & 0xFF]];
+    }
+
+    return address == end;
+}
+
+void CPU6502::armIdleLoop(u16 start) {
+    idleLoop.armed = true;
+    idleLoop.start = start;
+    idleLoop.sideEffects = false;
+    idleLoop.readsStatus = false;
+    idleLoop.clock = scheduler.now();
+    idleLoop.instructions = instructions;
+    idleLoop.accumulator = accumulator;
+    idleLoop.xRegister = xRegister;
+    idleLoop.yRegister = yRegister;
+    idleLoop.stackPointer = stackPointer;
+    idleLoop.statusRegister = statusRegister;
+}
+
+//The last pass left every register as it found it and only read RAM, ROM or
+//an unchanged PPUSTATUS, so every pass until the next event does the same.
+//Skip the whole passes that end before the interpreter would see the event.
+void CPU6502::skipIdleLoop() {
+    u64 now = scheduler.now();
+    u64 period = now - idleLoop.clock;
+    u64 limit = scheduler.nextDeadline();
+
+    if (idleLoop.readsStatus) {
+        syncPPU();
+
+        if (ppu->peekStatus() != idleLoop.status) {
+            return;
+        }
+
+        limit = std::min(limit, ppu->nextStatusChange());
+    }
+
+    if (period == 0 || limit <= now) {
+        return;
+    }
+
+    u64 passes = (limit - 1 - now) / period;
+    scheduler.advance(passes * period);
+    instructions += passes * (instructions - idleLoop.instructions);
+    skippedCycles += passes * period / CPU_CLOCK_DIVIDER;
+}
+
+void CPU6502::serviceEvents() {
+    Scheduler::Event event;
+
+    while (scheduler.popDue(event)) {
+        switch (event) {
+            case Scheduler::FRAME_START:
+            case Scheduler::VBLANK_START:
+            case Scheduler::VBLANK_END:
+                syncPPU();
+                ppu->scheduleEvents(scheduler);
+
+                if (ppu->genNMI()) {
+                    scheduler.schedule(Scheduler::NMI, scheduler.now());
+                }
+                break;
+            case Scheduler::NMI:
+                NMI();
+                break;
+            default:
+                //APU frame counter and mapper IRQs have no producer in this core yet
+                break;
+        }
+    }
 }
 
 inline void CPU6502::tick() {
-    ppu->tick();
-    ppu->tick();
-    ppu->tick();
-    ++cycle;
+    scheduler.advance(CPU_CLOCK_DIVIDER);
+}
+
+inline void CPU6502::syncPPU() {
+    ScopedTimer timer(profiling ? &times.ppu : nullptr);
+    ppu->catchUp(scheduler.now());
 }
 
 ExecutionState *CPU6502::getExecutionState() {
@@ -31,7 +422,8 @@ ExecutionState *CPU6502::getExecutionState() {
     execState->statusRegister = statusRegister;
     execState->programCounter = programCounter;
     execState->stackPointer = stackPointer;
-    execState->cycle = cycle;
+    //the reset sequence takes 7 cycles before the first instruction
+    execState->cycle = 7 + scheduler.now() / CPU_CLOCK_DIVIDER;
 
     return execState;
 }
@@ -78,6 +470,7 @@ void CPU6502::reset() {
 }
 
 inline void CPU6502::irq() {
+    idleLoop.armed = false;
     pushPC();
     pushStack(statusRegister);
     u8 lsb = read(0xFFFE);
@@ -86,6 +479,7 @@ inline void CPU6502::irq() {
 }
 
 inline void CPU6502::NMI() {
+    idleLoop.armed = false;
     SEI();
     pushPC();
     pushStack(statusRegister);
@@ -185,742 +579,355 @@ void CPU6502::tickIfToNewPage(u16 pc, u16 newPc) {
     }
 }
 
-void CPU6502::executeInstruction(u8 instruction) {
-    switch (instruction) {
-        case 0x69:
-            ADC(std::bind(&CPU6502::immediate, this));
-            break;
-        case 0x65:
-            ADC(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0x75:
-            ADC(std::bind(&CPU6502::zeroPageX, this));
-            break;
-        case 0x6D:
-            ADC(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0x7D:
-            ADC(std::bind(&CPU6502::absoluteX, this, /*extraTick*/ true));
-            break;
-        case 0x79:
-            ADC(std::bind(&CPU6502::absoluteY, this, /*extraTick*/ true));
-            break;
-        case 0x61:
-            ADC(std::bind(&CPU6502::indirectX, this));
-            break;
-        case 0x71:
-            ADC(std::bind(&CPU6502::indirectY, this, /*extraTick*/ true));
-            break;
-
-        case 0x29:
-            AND(std::bind(&CPU6502::immediate, this));
-            break;
-        case 0x25:
-            AND(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0x35:
-            AND(std::bind(&CPU6502::zeroPageX, this));
-            break;
-        case 0x2D:
-            AND(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0x3D:
-            AND(std::bind(&CPU6502::absoluteX, this, /*extraTick*/ true));
-            break;
-        case 0x39:
-            AND(std::bind(&CPU6502::absoluteY, this, /*extraTick*/ true));
-            break;
-        case 0x21:
-            AND(std::bind(&CPU6502::indirectX, this));
-            break;
-        case 0x31:
-            AND(std::bind(&CPU6502::indirectY, this, /*extraTick*/ true));
-            break;
-
-        case 0x0A:
-            ASL(nullptr);
-            break;
-        case 0x06:
-            ASL(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0x16:
-            ASL(std::bind(&CPU6502::zeroPageX, this));
-            break;
-        case 0x0E:
-            ASL(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0x1E:
-            ASL(std::bind(&CPU6502::absoluteX, this, /*extraTick*/ false));
-            tick();
-            break;
-
-        //START BRANCH INSTRUCTIONS, ALL RELATIVE!
-        case 0x90:
-            BCC(std::bind(&CPU6502::relative, this));
-            break;
-        case 0xB0:
-            BCS(std::bind(&CPU6502::relative, this));
-            break;
-        case 0xF0:
-            BEQ(std::bind(&CPU6502::relative, this));
-            break;
-        case 0x30:
-            BMI(std::bind(&CPU6502::relative, this));
-            break;
-        case 0xD0:
-            BNE(std::bind(&CPU6502::relative, this));
-            break;
-        case 0x10:
-            BPL(std::bind(&CPU6502::relative, this));
-            break;
-        case 0x50:
-            BVC(std::bind(&CPU6502::relative, this));
-            break;
-        case 0x70:
-            BVS(std::bind(&CPU6502::relative, this));
-            break;
-            //END BRANCH INSTRUCTION
-
-        case 0x24:
-            BIT(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0x2C:
-            BIT(std::bind(&CPU6502::absolute, this));
-            break;
-
-        case 0x00:
-            BRK();
-            break;
-
-        case 0x18:
-            CLC();
-            break;
-        case 0xD8:
-            CLD();
-            break;
-        case 0x58:
-            CLI();
-            break;
-        case 0xB8:
-            CLV();
-            break;
-
-        case 0xC9:
-            CMP(std::bind(&CPU6502::immediate, this));
-            break;
-        case 0xC5:
-            CMP(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0xD5:
-            CMP(std::bind(&CPU6502::zeroPageX, this));
-            break;
-        case 0xCD:
-            CMP(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0xDD:
-            CMP(std::bind(&CPU6502::absoluteX, this, /*extraTick*/ true));
-            break;
-        case 0xD9:
-            CMP(std::bind(&CPU6502::absoluteY, this, /*extraTick*/ true));
-            break;
-        case 0xC1:
-            CMP(std::bind(&CPU6502::indirectX, this));
-            break;
-        case 0xD1:
-            CMP(std::bind(&CPU6502::indirectY, this, /*extraTick*/ true));
-            break;
-
-        case 0xE0:
-            CPX(std::bind(&CPU6502::immediate, this));
-            break;
-        case 0xE4:
-            CPX(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0xEC:
-            CPX(std::bind(&CPU6502::absolute, this));
-            break;
-
-        case 0xC0:
-            CPY(std::bind(&CPU6502::immediate, this));
-            break;
-        case 0xC4:
-            CPY(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0xCC:
-            CPY(std::bind(&CPU6502::absolute, this));
-            break;
-
-        case 0xC6:
-            DEC(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0xD6:
-            DEC(std::bind(&CPU6502::zeroPageX, this));
-            break;
-        case 0xCE:
-            DEC(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0xDE:
-            DEC(std::bind(&CPU6502::absoluteX, this, /*extraTick*/ false));
-            tick();
-            break;
-
-        case 0xCA:
-            DEX();
-            break;
-        case 0x88:
-            DEY();
-            break;
-
-        case 0x49:
-            EOR(std::bind(&CPU6502::immediate, this));
-            break;
-        case 0x45:
-            EOR(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0x55:
-            EOR(std::bind(&CPU6502::zeroPageX, this));
-            break;
-        case 0x4D:
-            EOR(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0x5D:
-            EOR(std::bind(&CPU6502::absoluteX, this, /*extraTick*/ true));
-            break;
-        case 0x59:
-            EOR(std::bind(&CPU6502::absoluteY, this, /*extraTick*/ true));
-            break;
-        case 0x41:
-            EOR(std::bind(&CPU6502::indirectX, this));
-            break;
-        case 0x51:
-            EOR(std::bind(&CPU6502::indirectY, this, /*extraTick*/ true));
-            break;
-
-        case 0xE6:
-            INC(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0xF6:
-            INC(std::bind(&CPU6502::zeroPageX, this));
-            break;
-        case 0xEE:
-            INC(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0xFE:
-            INC(std::bind(&CPU6502::absoluteX, this, /*extraTick*/ false));
-            tick();
-            break;
-
-        case 0xE8:
-            INX();
-            break;
-        case 0xC8:
-            INY();
-            break;
-
-        case 0x4C:
-            JMP(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0x6C:
-            JMP(nullptr);
-            break;
-
-        case 0x20:
-            JSR(std::bind(&CPU6502::absolute, this));
-            break;
-
-        case 0xA9:
-            LDA(std::bind(&CPU6502::immediate, this));
-            break;
-        case 0xA5:
-            LDA(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0xB5:
-            LDA(std::bind(&CPU6502::zeroPageX, this));
-            break;
-        case 0xAD:
-            LDA(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0xBD:
-            LDA(std::bind(&CPU6502::absoluteX, this, /*extraTick*/ true));
-            break;
-        case 0xB9:
-            LDA(std::bind(&CPU6502::absoluteY, this, /*extraTick*/ true));
-            break;
-        case 0xA1:
-            LDA(std::bind(&CPU6502::indirectX, this));
-            break;
-        case 0xB1:
-            LDA(std::bind(&CPU6502::indirectY, this, /*extraTick*/ true));
-            break;
-
-        case 0xA2:
-            LDX(std::bind(&CPU6502::immediate, this));
-            break;
-        case 0xA6:
-            LDX(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0xB6:
-            LDX(std::bind(&CPU6502::zeroPageY, this));
-            tick();
-            break;
-        case 0xAE:
-            LDX(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0xBE:
-            LDX(std::bind(&CPU6502::absoluteY, this, /*extraTick*/ true));
-            break;
-
-        case 0xA0:
-            LDY(std::bind(&CPU6502::immediate, this));
-            break;
-        case 0xA4:
-            LDY(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0xB4:
-            LDY(std::bind(&CPU6502::zeroPageX, this));
-            break;
-        case 0xAC:
-            LDY(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0xBC:
-            LDY(std::bind(&CPU6502::absoluteX, this, /*extraTick*/ true));
-            break;
-
-        case 0x4A:
-            LSR(nullptr);
-            break;
-        case 0x46:
-            LSR(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0x56:
-            LSR(std::bind(&CPU6502::zeroPageX, this));
-            break;
-        case 0x4E:
-            LSR(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0x5E:
-            LSR(std::bind(&CPU6502::absoluteX, this, /*extraTick*/ false));
-            tick();
-            break;
-
-        case 0xEA:
-            NOP(nullptr);
-            break;
-
-        case 0x09:
-            ORA(std::bind(&CPU6502::immediate, this));
-            break;
-        case 0x05:
-            ORA(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0x15:
-            ORA(std::bind(&CPU6502::zeroPageX, this));
-            break;
-        case 0x0D:
-            ORA(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0x1D:
-            ORA(std::bind(&CPU6502::absoluteX, this, /*extraTick*/ true));
-            break;
-        case 0x19:
-            ORA(std::bind(&CPU6502::absoluteY, this, /*extraTick*/ true));
-            break;
-        case 0x01:
-            ORA(std::bind(&CPU6502::indirectX, this));
-            break;
-        case 0x11:
-            ORA(std::bind(&CPU6502::indirectY, this, /*extraTick*/ true));
-            break;
-
-        case 0x48:
-            PHA();
-            break;
-        case 0x08:
-            PHP();
-            break;
-        case 0x68:
-            PLA();
-            break;
-        case 0x28:
-            PLP();
-            break;
-
-        case 0x2A:
-            ROL(nullptr);
-            break;
-        case 0x26:
-            ROL(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0x36:
-            ROL(std::bind(&CPU6502::zeroPageX, this));
-            break;
-        case 0x2E:
-            ROL(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0x3E:
-            ROL(std::bind(&CPU6502::absoluteX, this, /*extraTick*/ false));
-            tick();
-            break;
-
-        case 0x6A:
-            ROR(nullptr);
-            break;
-        case 0x66:
-            ROR(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0x76:
-            ROR(std::bind(&CPU6502::zeroPageX, this));
-            break;
-        case 0x6E:
-            ROR(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0x7E:
-            ROR(std::bind(&CPU6502::absoluteX, this, /*extraTick*/ false));
-            tick();
-            break;
-
-        case 0x40:
-            RTI();
-            break;
-        case 0x60:
-            RTS();
-            break;
-
-        case 0xE9:
-        case 0xEB:
-            SBC(std::bind(&CPU6502::immediate, this));
-            break;
-        case 0xE5:
-            SBC(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0xF5:
-            SBC(std::bind(&CPU6502::zeroPageX, this));
-            break;
-        case 0xED:
-            SBC(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0xFD:
-            SBC(std::bind(&CPU6502::absoluteX, this, /*extraTick*/ true));
-            break;
-        case 0xF9:
-            SBC(std::bind(&CPU6502::absoluteY, this, /*extraTick*/ true));
-            break;
-        case 0xE1:
-            SBC(std::bind(&CPU6502::indirectX, this));
-            break;
-        case 0xF1:
-            SBC(std::bind(&CPU6502::indirectY, this, /*extraTick*/ true));
-            break;
-
-        case 0x38:
-            SEC();
-            break;
-        case 0xF8:
-            SED();
-            break;
-        case 0x78:
-            SEI();
-            break;
-
-        case 0x85:
-            STA(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0x95:
-            STA(std::bind(&CPU6502::zeroPageX, this));
-            break;
-        case 0x8D:
-            STA(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0x9D:
-            STA(std::bind(&CPU6502::absoluteX, this, /*extraTick*/ false));
-            tick();
-            break;
-        case 0x99:
-            STA(std::bind(&CPU6502::absoluteY, this, /*extraTick*/ false));
-            tick();
-            break;
-        case 0x81:
-            STA(std::bind(&CPU6502::indirectX, this));
-            break;
-        case 0x91:
-            STA(std::bind(&CPU6502::indirectY, this, /*extraTick*/ false));
-            tick();
-            break;
-
-        case 0x86:
-            STX(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0x96:
-            STX(std::bind(&CPU6502::zeroPageY, this));
-            tick();
-            break;
-        case 0x8E:
-            STX(std::bind(&CPU6502::absolute, this));
-            break;
-
-        case 0x84:
-            STY(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0x94:
-            STY(std::bind(&CPU6502::zeroPageX, this));
-            break;
-        case 0x8C:
-            STY(std::bind(&CPU6502::absolute, this));
-            break;
-
-        case 0xAA:
-            TAX();
-            break;
-        case 0xA8:
-            TAY();
-            break;
-        case 0xBA:
-            TSX();
-            break;
-        case 0x8A:
-            TXA();
-            break;
-        case 0x9A:
-            TXS();
-            break;
-        case 0x98:
-            TYA();
-            break;
-
-        //UNOFICIAL OPCODES
-        case 0x04:
-        case 0x44:
-        case 0x64:
-            NOP(std::bind(&CPU6502::zeroPage, this));
-            tick();
-            break;
-
-        case 0x0C:
-            NOP(std::bind(&CPU6502::absolute, this));
-            tick();
-            break;
-
-        case 0x14:
-        case 0x34:
-        case 0x54:
-        case 0x74:
-        case 0xD4:
-        case 0xF4:
-            NOP(std::bind(&CPU6502::zeroPageX, this));
-            tick();
-            break;
-
-        case 0x1A:
-        case 0x3A:
-        case 0x5A:
-        case 0x7A:
-        case 0xDA:
-        case 0xFA:
-            NOP(nullptr);
-            break;
+template <CPU6502::AddressingMode mode, bool pageCrossTick>
+inline u16 CPU6502::resolveAddress() {
+    switch (mode) {
+        case IMMEDIATE:
+            return immediate();
+        case ZERO_PAGE:
+            return zeroPage();
+        case ZERO_PAGE_X:
+            return zeroPageX();
+        case ZERO_PAGE_Y:
+            return zeroPageY();
+        case ABSOLUTE:
+            return absolute();
+        case ABSOLUTE_X:
+            return absoluteX(pageCrossTick);
+        case ABSOLUTE_Y:
+            return absoluteY(pageCrossTick);
+        case INDIRECT_X:
+            return indirectX();
+        case INDIRECT_Y:
+            return indirectY(pageCrossTick);
+    }
 
-        case 0x80:
-            NOP(std::bind(&CPU6502::immediate, this));
-            tick();
-            break;
+    return 0;
+}
 
-        case 0x1C:
-        case 0x3C:
-        case 0x5C:
-        case 0x7C:
-        case 0xDC:
-        case 0xFC:
-            NOP(std::bind(&CPU6502::absoluteX, this, /*extraTick*/ true));
-            tick();
-            break;
+template <void (CPU6502::*op)(u8), CPU6502::AddressingMode mode, bool pageCrossTick, int dummyTicks>
+void CPU6502::readOp() {
+    (this->*op)(read(resolveAddress<mode, pageCrossTick>()));
 
-        case 0xA3:
-            LAX(std::bind(&CPU6502::indirectX, this));
-            break;
-        case 0xA7:
-            LAX(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0xAF:
-            LAX(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0xB3:
-            LAX(std::bind(&CPU6502::indirectY, this, /*extraTick*/ true));
-            break;
-        case 0xB7:
-            LAX(std::bind(&CPU6502::zeroPageY, this));
-            tick();
-            break;
-        case 0xBF:
-            LAX(std::bind(&CPU6502::absoluteY, this, /*extraTick*/ true));
-            break;
-
-        case 0x83:
-            SAX(std::bind(&CPU6502::indirectX, this));
-            break;
-        case 0x87:
-            SAX(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0x8F:
-            SAX(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0x97:
-            SAX(std::bind(&CPU6502::zeroPageY, this));
-            tick();
-            break;
-
-        case 0xC3:
-            DCP(std::bind(&CPU6502::indirectX, this));
-            break;
-        case 0xC7:
-            DCP(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0xCF:
-            DCP(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0xD3:
-            DCP(std::bind(&CPU6502::indirectY, this, /*extraTick*/ true));
-            break;
-        case 0xD7:
-            DCP(std::bind(&CPU6502::zeroPageX, this));
-            break;
-        case 0xDB:
-            DCP(std::bind(&CPU6502::absoluteY, this, /*extraTick*/ true));
-            break;
-        case 0xDF:
-            DCP(std::bind(&CPU6502::absoluteX, this, /*extraTick*/ true));
-            break;
+    for (int i = 0; i < dummyTicks; i++) {
+        tick();
+    }
+}
 
-        case 0xE3:
-            ISB(std::bind(&CPU6502::indirectX, this));
-            break;
-        case 0xE7:
-            ISB(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0xEF:
-            ISB(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0xF3:
-            ISB(std::bind(&CPU6502::indirectY, this, /*extraTick*/ true));
-            break;
-        case 0xF7:
-            ISB(std::bind(&CPU6502::zeroPageX, this));
-            break;
-        case 0xFB:
-            ISB(std::bind(&CPU6502::absoluteY, this, /*extraTick*/ true));
-            break;
-        case 0xFF:
-            ISB(std::bind(&CPU6502::absoluteX, this, /*extraTick*/ true));
-            break;
+template <void (CPU6502::*op)(u16), CPU6502::AddressingMode mode, bool pageCrossTick, int dummyTicks>
+void CPU6502::addressOp() {
+    (this->*op)(resolveAddress<mode, pageCrossTick>());
 
-        case 0x03:
-            SLO(std::bind(&CPU6502::indirectX, this));
-            break;
-        case 0x07:
-            SLO(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0x0F:
-            SLO(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0x13:
-            SLO(std::bind(&CPU6502::indirectY, this, /*extraTick*/ false));
-            tick();
-            break;
-        case 0x17:
-            SLO(std::bind(&CPU6502::zeroPageX, this));
-            break;
-        case 0x1B:
-            SLO(std::bind(&CPU6502::absoluteY, this, /*extraTick*/ false));
-            tick();
-            break;
-        case 0x1F:
-            SLO(std::bind(&CPU6502::absoluteX, this, /*extraTick*/ false));
-            tick();
-            break;
+    for (int i = 0; i < dummyTicks; i++) {
+        tick();
+    }
+}
 
-        case 0x23:
-            RLA(std::bind(&CPU6502::indirectX, this));
-            break;
-        case 0x27:
-            RLA(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0x2F:
-            RLA(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0x33:
-            RLA(std::bind(&CPU6502::indirectY, this, /*extraTick*/ false));
-            tick();
-            break;
-        case 0x37:
-            RLA(std::bind(&CPU6502::zeroPageX, this));
-            break;
-        case 0x3B:
-            RLA(std::bind(&CPU6502::absoluteY, this, /*extraTick*/ false));
-            tick();
-            break;
-        case 0x3F:
-            RLA(std::bind(&CPU6502::absoluteX, this, /*extraTick*/ false));
-            tick();
-            break;
+template <u8 (CPU6502::*op)(u8)>
+void CPU6502::accumulatorOp() {
+    accumulator = (this->*op)(accumulator);
+    tick();
+}
 
-        case 0x43:
-            SRE(std::bind(&CPU6502::indirectX, this));
-            break;
-        case 0x47:
-            SRE(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0x4F:
-            SRE(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0x53:
-            SRE(std::bind(&CPU6502::indirectY, this, /*extraTick*/ false));
-            tick();
-            break;
-        case 0x57:
-            SRE(std::bind(&CPU6502::zeroPageX, this));
-            break;
-        case 0x5B:
-            SRE(std::bind(&CPU6502::absoluteY, this, /*extraTick*/ false));
-            tick();
-            break;
-        case 0x5F:
-            SRE(std::bind(&CPU6502::absoluteX, this, /*extraTick*/ false));
-            tick();
-            break;
+template <u8 opcode>
+void CPU6502::unknownOpcode() {
+    std::cout << "Unkown instruction " << opcode;
+    programCounter++;
+}
 
-        case 0x63:
-            RRA(std::bind(&CPU6502::indirectX, this));
-            break;
-        case 0x67:
-            RRA(std::bind(&CPU6502::zeroPage, this));
-            break;
-        case 0x6F:
-            RRA(std::bind(&CPU6502::absolute, this));
-            break;
-        case 0x73:
-            RRA(std::bind(&CPU6502::indirectY, this, /*extraTick*/ false));
-            tick();
-            break;
-        case 0x77:
-            RRA(std::bind(&CPU6502::zeroPageX, this));
-            break;
-        case 0x7B:
-            RRA(std::bind(&CPU6502::absoluteY, this, /*extraTick*/ false));
-            tick();
-            break;
-        case 0x7F:
-            RRA(std::bind(&CPU6502::absoluteX, this, /*extraTick*/ false));
-            tick();
-            break;
+//Instruction lengths for block decoding, 0 for unknown opcodes
+const u8 CPU6502::opcodeLengths[256] = {
+    1, 2, 0, 2, 2, 2, 2, 2, 1, 2, 1, 0, 3, 3, 3, 3,  //00
+    2, 2, 0, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,  //10
+    3, 2, 0, 2, 2, 2, 2, 2, 1, 2, 1, 0, 3, 3, 3, 3,  //20
+    2, 2, 0, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,  //30
+    1, 2, 0, 2, 2, 2, 2, 2, 1, 2, 1, 0, 3, 3, 3, 3,  //40
+    2, 2, 0, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,  //50
+    1, 2, 0, 2, 2, 2, 2, 2, 1, 2, 1, 0, 3, 3, 3, 3,  //60
+    2, 2, 0, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,  //70
+    2, 2, 0, 2, 2, 2, 2, 2, 1, 0, 1, 0, 3, 3, 3, 3,  //80
+    2, 2, 0, 0, 2, 2, 2, 2, 1, 3, 1, 0, 0, 3, 0, 0,  //90
+    2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 0, 3, 3, 3, 3,  //A0
+    2, 2, 0, 2, 2, 2, 2, 2, 1, 3, 1, 0, 3, 3, 3, 3,  //B0
+    2, 2, 0, 2, 2, 2, 2, 2, 1, 2, 1, 0, 3, 3, 3, 3,  //C0
+    2, 2, 0, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,  //D0
+    2, 2, 0, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3,  //E0
+    2, 2, 0, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,  //F0
+};
+
+//Handlers are specialized per (operation, addressing mode) at compile time.
+//pageCrossTick adds the extra cycle when indexing crosses a page, dummyTicks
+//are the fixed extra cycles of stores, read-modify-writes and unofficial NOPs.
+const CPU6502::OpcodeHandler CPU6502::opcodeTable[256] = {
+    &CPU6502::BRK,  //00
+    &CPU6502::readOp<&CPU6502::ORA, INDIRECT_X>,  //01
+    &CPU6502::unknownOpcode<0x02>,  //02
+    &CPU6502::addressOp<&CPU6502::SLO, INDIRECT_X>,  //03
+    &CPU6502::addressOp<&CPU6502::NOP, ZERO_PAGE, false, 1>,  //04
+    &CPU6502::readOp<&CPU6502::ORA, ZERO_PAGE>,  //05
+    &CPU6502::addressOp<&CPU6502::ASL, ZERO_PAGE>,  //06
+    &CPU6502::addressOp<&CPU6502::SLO, ZERO_PAGE>,  //07
+    &CPU6502::PHP,  //08
+    &CPU6502::readOp<&CPU6502::ORA, IMMEDIATE>,  //09
+    &CPU6502::accumulatorOp<&CPU6502::ASL_val>,  //0A
+    &CPU6502::unknownOpcode<0x0B>,  //0B
+    &CPU6502::addressOp<&CPU6502::NOP, ABSOLUTE, false, 1>,  //0C
+    &CPU6502::readOp<&CPU6502::ORA, ABSOLUTE>,  //0D
+    &CPU6502::addressOp<&CPU6502::ASL, ABSOLUTE>,  //0E
+    &CPU6502::addressOp<&CPU6502::SLO, ABSOLUTE>,  //0F
+    &CPU6502::BPL,  //10
+    &CPU6502::readOp<&CPU6502::ORA, INDIRECT_Y, true>,  //11
+    &CPU6502::unknownOpcode<0x12>,  //12
+    &CPU6502::addressOp<&CPU6502::SLO, INDIRECT_Y, false, 1>,  //13
+    &CPU6502::addressOp<&CPU6502::NOP, ZERO_PAGE_X, false, 1>,  //14
+    &CPU6502::readOp<&CPU6502::ORA, ZERO_PAGE_X>,  //15
+    &CPU6502::addressOp<&CPU6502::ASL, ZERO_PAGE_X>,  //16
+    &CPU6502::addressOp<&CPU6502::SLO, ZERO_PAGE_X>,  //17
+    &CPU6502::CLC,  //18
+    &CPU6502::readOp<&CPU6502::ORA, ABSOLUTE_Y, true>,  //19
+    &CPU6502::NOP,  //1A
+    &CPU6502::addressOp<&CPU6502::SLO, ABSOLUTE_Y, false, 1>,  //1B
+    &CPU6502::addressOp<&CPU6502::NOP, ABSOLUTE_X, true, 1>,  //1C
+    &CPU6502::readOp<&CPU6502::ORA, ABSOLUTE_X, true>,  //1D
+    &CPU6502::addressOp<&CPU6502::ASL, ABSOLUTE_X, false, 1>,  //1E
+    &CPU6502::addressOp<&CPU6502::SLO, ABSOLUTE_X, false, 1>,  //1F
+    &CPU6502::addressOp<&CPU6502::JSR, ABSOLUTE>,  //20
+    &CPU6502::readOp<&CPU6502::AND, INDIRECT_X>,  //21
+    &CPU6502::unknownOpcode<0x22>,  //22
+    &CPU6502::addressOp<&CPU6502::RLA, INDIRECT_X>,  //23
+    &CPU6502::readOp<&CPU6502::BIT, ZERO_PAGE>,  //24
+    &CPU6502::readOp<&CPU6502::AND, ZERO_PAGE>,  //25
+    &CPU6502::addressOp<&CPU6502::ROL, ZERO_PAGE>,  //26
+    &CPU6502::addressOp<&CPU6502::RLA, ZERO_PAGE>,  //27
+    &CPU6502::PLP,  //28
+    &CPU6502::readOp<&CPU6502::AND, IMMEDIATE>,  //29
+    &CPU6502::accumulatorOp<&CPU6502::ROL_val>,  //2A
+    &CPU6502::unknownOpcode<0x2B>,  //2B
+    &CPU6502::readOp<&CPU6502::BIT, ABSOLUTE>,  //2C
+    &CPU6502::readOp<&CPU6502::AND, ABSOLUTE>,  //2D
+    &CPU6502::addressOp<&CPU6502::ROL, ABSOLUTE>,  //2E
+    &CPU6502::addressOp<&CPU6502::RLA, ABSOLUTE>,  //2F
+    &CPU6502::BMI,  //30
+    &CPU6502::readOp<&CPU6502::AND, INDIRECT_Y, true>,  //31
+    &CPU6502::unknownOpcode<0x32>,  //32
+    &CPU6502::addressOp<&CPU6502::RLA, INDIRECT_Y, false, 1>,  //33
+    &CPU6502::addressOp<&CPU6502::NOP, ZERO_PAGE_X, false, 1>,  //34
+    &CPU6502::readOp<&CPU6502::AND, ZERO_PAGE_X>,  //35
+    &CPU6502::addressOp<&CPU6502::ROL, ZERO_PAGE_X>,  //36
+    &CPU6502::addressOp<&CPU6502::RLA, ZERO_PAGE_X>,  //37
+    &CPU6502::SEC,  //38
+    &CPU6502::readOp<&CPU6502::AND, ABSOLUTE_Y, true>,  //39
+    &CPU6502::NOP,  //3A
+    &CPU6502::addressOp<&CPU6502::RLA, ABSOLUTE_Y, false, 1>,  //3B
+    &CPU6502::addressOp<&CPU6502::NOP, ABSOLUTE_X, true, 1>,  //3C
+    &CPU6502::readOp<&CPU6502::AND, ABSOLUTE_X, true>,  //3D
+    &CPU6502::addressOp<&CPU6502::ROL, ABSOLUTE_X, false, 1>,  //3E
+    &CPU6502::addressOp<&CPU6502::RLA, ABSOLUTE_X, false, 1>,  //3F
+    &CPU6502::RTI,  //40
+    &CPU6502::readOp<&CPU6502::EOR, INDIRECT_X>,  //41
+    &CPU6502::unknownOpcode<0x42>,  //42
+    &CPU6502::addressOp<&CPU6502::SRE, INDIRECT_X>,  //43
+    &CPU6502::addressOp<&CPU6502::NOP, ZERO_PAGE, false, 1>,  //44
+    &CPU6502::readOp<&CPU6502::EOR, ZERO_PAGE>,  //45
+    &CPU6502::addressOp<&CPU6502::LSR, ZERO_PAGE>,  //46
+    &CPU6502::addressOp<&CPU6502::SRE, ZERO_PAGE>,  //47
+    &CPU6502::PHA,  //48
+    &CPU6502::readOp<&CPU6502::EOR, IMMEDIATE>,  //49
+    &CPU6502::accumulatorOp<&CPU6502::LSR_val>,  //4A
+    &CPU6502::unknownOpcode<0x4B>,  //4B
+    &CPU6502::addressOp<&CPU6502::JMP, ABSOLUTE>,  //4C
+    &CPU6502::readOp<&CPU6502::EOR, ABSOLUTE>,  //4D
+    &CPU6502::addressOp<&CPU6502::LSR, ABSOLUTE>,  //4E
+    &CPU6502::addressOp<&CPU6502::SRE, ABSOLUTE>,  //4F
+    &CPU6502::BVC,  //50
+    &CPU6502::readOp<&CPU6502::EOR, INDIRECT_Y, true>,  //51
+    &CPU6502::unknownOpcode<0x52>,  //52
+    &CPU6502::addressOp<&CPU6502::SRE, INDIRECT_Y, false, 1>,  //53
+    &CPU6502::addressOp<&CPU6502::NOP, ZERO_PAGE_X, false, 1>,  //54
+    &CPU6502::readOp<&CPU6502::EOR, ZERO_PAGE_X>,  //55
+    &CPU6502::addressOp<&CPU6502::LSR, ZERO_PAGE_X>,  //56
+    &CPU6502::addressOp<&CPU6502::SRE, ZERO_PAGE_X>,  //57
+    &CPU6502::CLI,  //58
+    &CPU6502::readOp<&CPU6502::EOR, ABSOLUTE_Y, true>,  //59
+    &CPU6502::NOP,  //5A
+    &CPU6502::addressOp<&CPU6502::SRE, ABSOLUTE_Y, false, 1>,  //5B
+    &CPU6502::addressOp<&CPU6502::NOP, ABSOLUTE_X, true, 1>,  //5C
+    &CPU6502::readOp<&CPU6502::EOR, ABSOLUTE_X, true>,  //5D
+    &CPU6502::addressOp<&CPU6502::LSR, ABSOLUTE_X, false, 1>,  //5E
+    &CPU6502::addressOp<&CPU6502::SRE, ABSOLUTE_X, false, 1>,  //5F
+    &CPU6502::RTS,  //60
+    &CPU6502::readOp<&CPU6502::ADC, INDIRECT_X>,  //61
+    &CPU6502::unknownOpcode<0x62>,  //62
+    &CPU6502::addressOp<&CPU6502::RRA, INDIRECT_X>,  //63
+    &CPU6502::addressOp<&CPU6502::NOP, ZERO_PAGE, false, 1>,  //64
+    &CPU6502::readOp<&CPU6502::ADC, ZERO_PAGE>,  //65
+    &CPU6502::addressOp<&CPU6502::ROR, ZERO_PAGE>,  //66
+    &CPU6502::addressOp<&CPU6502::RRA, ZERO_PAGE>,  //67
+    &CPU6502::PLA,  //68
+    &CPU6502::readOp<&CPU6502::ADC, IMMEDIATE>,  //69
+    &CPU6502::accumulatorOp<&CPU6502::ROR_val>,  //6A
+    &CPU6502::unknownOpcode<0x6B>,  //6B
+    &CPU6502::JMPIndirect,  //6C
+    &CPU6502::readOp<&CPU6502::ADC, ABSOLUTE>,  //6D
+    &CPU6502::addressOp<&CPU6502::ROR, ABSOLUTE>,  //6E
+    &CPU6502::addressOp<&CPU6502::RRA, ABSOLUTE>,  //6F
+    &CPU6502::BVS,  //70
+    &CPU6502::readOp<&CPU6502::ADC, INDIRECT_Y, true>,  //71
+    &CPU6502::unknownOpcode<0x72>,  //72
+    &CPU6502::addressOp<&CPU6502::RRA, INDIRECT_Y, false, 1>,  //73
+    &CPU6502::addressOp<&CPU6502::NOP, ZERO_PAGE_X, false, 1>,  //74
+    &CPU6502::readOp<&CPU6502::ADC, ZERO_PAGE_X>,  //75
+    &CPU6502::addressOp<&CPU6502::ROR, ZERO_PAGE_X>,  //76
+    &CPU6502::addressOp<&CPU6502::RRA, ZERO_PAGE_X>,  //77
+    &CPU6502::SEI,  //78
+    &CPU6502::readOp<&CPU6502::ADC, ABSOLUTE_Y, true>,  //79
+    &CPU6502::NOP,  //7A
+    &CPU6502::addressOp<&CPU6502::RRA, ABSOLUTE_Y, false, 1>,  //7B
+    &CPU6502::addressOp<&CPU6502::NOP, ABSOLUTE_X, true, 1>,  //7C
+    &CPU6502::readOp<&CPU6502::ADC, ABSOLUTE_X, true>,  //7D
+    &CPU6502::addressOp<&CPU6502::ROR, ABSOLUTE_X, false, 1>,  //7E
+    &CPU6502::addressOp<&CPU6502::RRA, ABSOLUTE_X, false, 1>,  //7F
+    &CPU6502::addressOp<&CPU6502::NOP, IMMEDIATE, false, 1>,  //80
+    &CPU6502::addressOp<&CPU6502::STA, INDIRECT_X>,  //81
+    &CPU6502::unknownOpcode<0x82>,  //82
+    &CPU6502::addressOp<&CPU6502::SAX, INDIRECT_X>,  //83
+    &CPU6502::addressOp<&CPU6502::STY, ZERO_PAGE>,  //84
+    &CPU6502::addressOp<&CPU6502::STA, ZERO_PAGE>,  //85
+    &CPU6502::addressOp<&CPU6502::STX, ZERO_PAGE>,  //86
+    &CPU6502::addressOp<&CPU6502::SAX, ZERO_PAGE>,  //87
+    &CPU6502::DEY,  //88
+    &CPU6502::unknownOpcode<0x89>,  //89
+    &CPU6502::TXA,  //8A
+    &CPU6502::unknownOpcode<0x8B>,  //8B
+    &CPU6502::addressOp<&CPU6502::STY, ABSOLUTE>,  //8C
+    &CPU6502::addressOp<&CPU6502::STA, ABSOLUTE>,  //8D
+    &CPU6502::addressOp<&CPU6502::STX, ABSOLUTE>,  //8E
+    &CPU6502::addressOp<&CPU6502::SAX, ABSOLUTE>,  //8F
+    &CPU6502::BCC,  //90
+    &CPU6502::addressOp<&CPU6502::STA, INDIRECT_Y, false, 1>,  //91
+    &CPU6502::unknownOpcode<0x92>,  //92
+    &CPU6502::unknownOpcode<0x93>,  //93
+    &CPU6502::addressOp<&CPU6502::STY, ZERO_PAGE_X>,  //94
+    &CPU6502::addressOp<&CPU6502::STA, ZERO_PAGE_X>,  //95
+    &CPU6502::addressOp<&CPU6502::STX, ZERO_PAGE_Y, false, 1>,  //96
+    &CPU6502::addressOp<&CPU6502::SAX, ZERO_PAGE_Y, false, 1>,  //97
+    &CPU6502::TYA,  //98
+    &CPU6502::addressOp<&CPU6502::STA, ABSOLUTE_Y, false, 1>,  //99
+    &CPU6502::TXS,  //9A
+    &CPU6502::unknownOpcode<0x9B>,  //9B
+    &CPU6502::unknownOpcode<0x9C>,  //9C
+    &CPU6502::addressOp<&CPU6502::STA, ABSOLUTE_X, false, 1>,  //9D
+    &CPU6502::unknownOpcode<0x9E>,  //9E
+    &CPU6502::unknownOpcode<0x9F>,  //9F
+    &CPU6502::readOp<&CPU6502::LDY, IMMEDIATE>,  //A0
+    &CPU6502::readOp<&CPU6502::LDA, INDIRECT_X>,  //A1
+    &CPU6502::readOp<&CPU6502::LDX, IMMEDIATE>,  //A2
+    &CPU6502::readOp<&CPU6502::LAX, INDIRECT_X>,  //A3
+    &CPU6502::readOp<&CPU6502::LDY, ZERO_PAGE>,  //A4
+    &CPU6502::readOp<&CPU6502::LDA, ZERO_PAGE>,  //A5
+    &CPU6502::readOp<&CPU6502::LDX, ZERO_PAGE>,  //A6
+    &CPU6502::readOp<&CPU6502::LAX, ZERO_PAGE>,  //A7
+    &CPU6502::TAY,  //A8
+    &CPU6502::readOp<&CPU6502::LDA, IMMEDIATE>,  //A9
+    &CPU6502::TAX,  //AA
+    &CPU6502::unknownOpcode<0xAB>,  //AB
+    &CPU6502::readOp<&CPU6502::LDY, ABSOLUTE>,  //AC
+    &CPU6502::readOp<&CPU6502::LDA, ABSOLUTE>,  //AD
+    &CPU6502::readOp<&CPU6502::LDX, ABSOLUTE>,  //AE
+    &CPU6502::readOp<&CPU6502::LAX, ABSOLUTE>,  //AF
+    &CPU6502::BCS,  //B0
+    &CPU6502::readOp<&CPU6502::LDA, INDIRECT_Y, true>,  //B1
+    &CPU6502::unknownOpcode<0xB2>,  //B2
+    &CPU6502::readOp<&CPU6502::LAX, INDIRECT_Y, true>,  //B3
+    &CPU6502::readOp<&CPU6502::LDY, ZERO_PAGE_X>,  //B4
+    &CPU6502::readOp<&CPU6502::LDA, ZERO_PAGE_X>,  //B5
+    &CPU6502::readOp<&CPU6502::LDX, ZERO_PAGE_Y, false, 1>,  //B6
+    &CPU6502::readOp<&CPU6502::LAX, ZERO_PAGE_Y, false, 1>,  //B7
+    &CPU6502::CLV,  //B8
+    &CPU6502::readOp<&CPU6502::LDA, ABSOLUTE_Y, true>,  //B9
+    &CPU6502::TSX,  //BA
+    &CPU6502::unknownOpcode<0xBB>,  //BB
+    &CPU6502::readOp<&CPU6502::LDY, ABSOLUTE_X, true>,  //BC
+    &CPU6502::readOp<&CPU6502::LDA, ABSOLUTE_X, true>,  //BD
+    &CPU6502::readOp<&CPU6502::LDX, ABSOLUTE_Y, true>,  //BE
+    &CPU6502::readOp<&CPU6502::LAX, ABSOLUTE_Y, true>,  //BF
+    &CPU6502::readOp<&CPU6502::CPY, IMMEDIATE>,  //C0
+    &CPU6502::readOp<&CPU6502::CMP, INDIRECT_X>,  //C1
+    &CPU6502::unknownOpcode<0xC2>,  //C2
+    &CPU6502::addressOp<&CPU6502::DCP, INDIRECT_X>,  //C3
+    &CPU6502::readOp<&CPU6502::CPY, ZERO_PAGE>,  //C4
+    &CPU6502::readOp<&CPU6502::CMP, ZERO_PAGE>,  //C5
+    &CPU6502::addressOp<&CPU6502::DEC, ZERO_PAGE>,  //C6
+    &CPU6502::addressOp<&CPU6502::DCP, ZERO_PAGE>,  //C7
+    &CPU6502::INY,  //C8
+    &CPU6502::readOp<&CPU6502::CMP, IMMEDIATE>,  //C9
+    &CPU6502::DEX,  //CA
+    &CPU6502::unknownOpcode<0xCB>,  //CB
+    &CPU6502::readOp<&CPU6502::CPY, ABSOLUTE>,  //CC
+    &CPU6502::readOp<&CPU6502::CMP, ABSOLUTE>,  //CD
+    &CPU6502::addressOp<&CPU6502::DEC, ABSOLUTE>,  //CE
+    &CPU6502::addressOp<&CPU6502::DCP, ABSOLUTE>,  //CF
+    &CPU6502::BNE,  //D0
+    &CPU6502::readOp<&CPU6502::CMP, INDIRECT_Y, true>,  //D1
+    &CPU6502::unknownOpcode<0xD2>,  //D2
+    &CPU6502::addressOp<&CPU6502::DCP, INDIRECT_Y, true>,  //D3
+    &CPU6502::addressOp<&CPU6502::NOP, ZERO_PAGE_X, false, 1>,  //D4
+    &CPU6502::readOp<&CPU6502::CMP, ZERO_PAGE_X>,  //D5
+    &CPU6502::addressOp<&CPU6502::DEC, ZERO_PAGE_X>,  //D6
+    &CPU6502::addressOp<&CPU6502::DCP, ZERO_PAGE_X>,  //D7
+    &CPU6502::CLD,  //D8
+    &CPU6502::readOp<&CPU6502::CMP, ABSOLUTE_Y, true>,  //D9
+    &CPU6502::NOP,  //DA
+    &CPU6502::addressOp<&CPU6502::DCP, ABSOLUTE_Y, true>,  //DB
+    &CPU6502::addressOp<&CPU6502::NOP, ABSOLUTE_X, true, 1>,  //DC
+    &CPU6502::readOp<&CPU6502::CMP, ABSOLUTE_X, true>,  //DD
+    &CPU6502::addressOp<&CPU6502::DEC, ABSOLUTE_X, false, 1>,  //DE
+    &CPU6502::addressOp<&CPU6502::DCP, ABSOLUTE_X, true>,  //DF
+    &CPU6502::readOp<&CPU6502::CPX, IMMEDIATE>,  //E0
+    &CPU6502::readOp<&CPU6502::SBC, INDIRECT_X>,  //E1
+    &CPU6502::unknownOpcode<0xE2>,  //E2
+    &CPU6502::addressOp<&CPU6502::ISB, INDIRECT_X>,  //E3
+    &CPU6502::readOp<&CPU6502::CPX, ZERO_PAGE>,  //E4
+    &CPU6502::readOp<&CPU6502::SBC, ZERO_PAGE>,  //E5
+    &CPU6502::addressOp<&CPU6502::INC, ZERO_PAGE>,  //E6
+    &CPU6502::addressOp<&CPU6502::ISB, ZERO_PAGE>,  //E7
+    &CPU6502::INX,  //E8
+    &CPU6502::readOp<&CPU6502::SBC, IMMEDIATE>,  //E9
+    &CPU6502::NOP,  //EA
+    &CPU6502::readOp<&CPU6502::SBC, IMMEDIATE>,  //EB
+    &CPU6502::readOp<&CPU6502::CPX, ABSOLUTE>,  //EC
+    &CPU6502::readOp<&CPU6502::SBC, ABSOLUTE>,  //ED
+    &CPU6502::addressOp<&CPU6502::INC, ABSOLUTE>,  //EE
+    &CPU6502::addressOp<&CPU6502::ISB, ABSOLUTE>,  //EF
+    &CPU6502::BEQ,  //F0
+    &CPU6502::readOp<&CPU6502::SBC, INDIRECT_Y, true>,  //F1
+    &CPU6502::unknownOpcode<0xF2>,  //F2
+    &CPU6502::addressOp<&CPU6502::ISB, INDIRECT_Y, true>,  //F3
+    &CPU6502::addressOp<&CPU6502::NOP, ZERO_PAGE_X, false, 1>,  //F4
+    &CPU6502::readOp<&CPU6502::SBC, ZERO_PAGE_X>,  //F5
+    &CPU6502::addressOp<&CPU6502::INC, ZERO_PAGE_X>,  //F6
+    &CPU6502::addressOp<&CPU6502::ISB, ZERO_PAGE_X>,  //F7
+    &CPU6502::SED,  //F8
+    &CPU6502::readOp<&CPU6502::SBC, ABSOLUTE_Y, true>,  //F9
+    &CPU6502::NOP,  //FA
+    &CPU6502::addressOp<&CPU6502::ISB, ABSOLUTE_Y, true>,  //FB
+    &CPU6502::addressOp<&CPU6502::NOP, ABSOLUTE_X, true, 1>,  //FC
+    &CPU6502::readOp<&CPU6502::SBC, ABSOLUTE_X, true>,  //FD
+    &CPU6502::addressOp<&CPU6502::INC, ABSOLUTE_X, false, 1>,  //FE
+    &CPU6502::addressOp<&CPU6502::ISB, ABSOLUTE_X, true>,  //FF
+};
 
-        default:
-            std::cout << "Unkown instruction " << instruction;
-            programCounter++;
-            break;
-    }
+void CPU6502::executeInstruction(u8 instruction) {
+    (this->*opcodeTable[instruction])();
 }
 
 u8 CPU6502::memoryAccess(MemoryAccessMode mode, u16 address, u8 data) {
     u8 readData = 0;
+    bool statusRead = mode == MemoryAccessMode::READ && (address & 0xE007) == 0x2002;
+
+    if (idleLoop.armed && !statusRead && !(mode == MemoryAccessMode::READ && address < 0x2000)) {
+        idleLoop.sideEffects = true;
+    }
 
     if (address >= 0 && address < 0x2000) {
         if (mode == MemoryAccessMode::READ) {
@@ -929,8 +936,19 @@ u8 CPU6502::memoryAccess(MemoryAccessMode mode, u16 address, u8 data) {
             ram.write(address, data);
         }
     } else if (address >= 0x2000 && address < 0x4000) {
+        syncPPU();
+
         if (mode == MemoryAccessMode::READ) {
             readData = ppu->read(address);
+
+            if (idleLoop.armed && statusRead) {
+                if (!idleLoop.readsStatus) {
+                    idleLoop.readsStatus = true;
+                    idleLoop.status = readData;
+                } else if (idleLoop.status != readData) {
+                    idleLoop.sideEffects = true;
+                }
+            }
         } else {
             ppu->write(address, data);
         }
@@ -940,12 +958,28 @@ u8 CPU6502::memoryAccess(MemoryAccessMode mode, u16 address, u8 data) {
             if (mode == MemoryAccessMode::READ) {
                 std::cout << "No read access at 0x4014";
             } else {
+                syncPPU();
                 ppu->write(address, data);
 
-                for (int i = 0; i < 256; i++) {
-                    tick();
-                    ppu->copyOAM(read(data * 256 + i), i);
+                //RAM and ROM pages are copied straight from where they live,
+                //anything else is read byte by byte. OAM gets the whole page
+                //once the transfer is done.
+                const u8 *page = pageTable.read[data];
+                u8 bytes[256];
+
+                if (page != nullptr) {
+                    scheduler.advance(512 * CPU_CLOCK_DIVIDER);
+                } else {
+                    for (int i = 0; i < 256; i++) {
+                        tick();
+                        bytes[i] = read(data * 256 + i);
+                    }
+
+                    page = bytes;
                 }
+
+                syncPPU();
+                ppu->copyOAMPage(page);
             }
         } else {
             if (mode == MemoryAccessMode::READ) {
@@ -959,9 +993,14 @@ u8 CPU6502::memoryAccess(MemoryAccessMode mode, u16 address, u8 data) {
         //CPU test mode
     } else if (address >= 0x6000 && address <= 0xFFFF) {
         if (mode == MemoryAccessMode::READ) {
+            ScopedTimer timer(profiling ? &times.mapper : nullptr);
             readData = mapper->read(address);
         } else {
+            //bank switches change what the PPU fetches
+            syncPPU();
+            ScopedTimer timer(profiling ? &times.mapper : nullptr);
             mapper->write(address, data);
+            blockAborted = true;
         }
     }
 
@@ -971,10 +1010,31 @@ u8 CPU6502::memoryAccess(MemoryAccessMode mode, u16 address, u8 data) {
 }
 
 u8 CPU6502::read(u16 address) {
+    const u8 *page = pageTable.read[address >> 8];
+
+    if (page != nullptr) {
+        u8 data = page[address & 0xFF];
+        tick();
+        return data;
+    }
+
     return memoryAccess(MemoryAccessMode::READ, address, 0);
 }
 
 void CPU6502::write(u16 address, u8 data) {
+    u8 *page = pageTable.write[address >> 8];
+
+    if (page != nullptr) {
+        page[address & 0xFF] = data;
+        tick();
+
+        if (codeWatch[address >> 8]) {
+            codeWritten(address);
+        }
+
+        return;
+    }
+
     memoryAccess(MemoryAccessMode::WRITE, address, data);
 }
 
@@ -1028,10 +1088,6 @@ u8 CPU6502::popStack() {
     return read(stackPointer + 256);
 }
 
-void CPU6502::ADC(std::function<u16()> addressing) {
-    ADC(read(addressing()));
-}
-
 void CPU6502::ADC(u8 data) {
     u8 carry = statusRegister & 1;
     u16 sum = data + accumulator + carry;
@@ -1043,26 +1099,16 @@ void CPU6502::ADC(u8 data) {
     setOverflow(overflow);
 }
 
-void CPU6502::AND(std::function<u16()> addressing) {
-    AND(read(addressing()));
-}
-
 void CPU6502::AND(u8 data) {
     accumulator &= data;
     setNegative(accumulator & 0x80);
     setZero(accumulator == 0);
 }
 
-void CPU6502::ASL(std::function<u16()> addressing) {
-    if (addressing == nullptr) {
-        accumulator = ASL_val(accumulator);
-        tick();
-    } else {
-        u16 address = addressing();
-        u8 data = ASL_val(read(address));
-        write(address, data);
-        tick();
-    }
+void CPU6502::ASL(u16 address) {
+    u8 data = ASL_val(read(address));
+    write(address, data);
+    tick();
 }
 
 u8 CPU6502::ASL_val(u8 data) {
@@ -1074,60 +1120,64 @@ u8 CPU6502::ASL_val(u8 data) {
     return data;
 }
 
-void CPU6502::commonBranchLogic(bool expr, std::function<u16()> resolvePC) {
+void CPU6502::commonBranchLogic(bool expr) {
     if (expr) {
-        u16 newPC = resolvePC();
+        u16 from = programCounter;
+        u16 newPC = relative();
         tickIfToNewPage(programCounter + 1, newPC + 1);
         programCounter = newPC;
         tick();
+
+        if (idleLoopSkip && (u16)(newPC + 1) <= from) {
+            idleLoopJump(from, newPC + 1);
+        }
     } else {
         programCounter++;
         tick();
     }
 }
 
-void CPU6502::BCC(std::function<u16()> resolvePC) {
+void CPU6502::BCC() {
     u8 carry = statusRegister & 1;
-    commonBranchLogic(!carry, resolvePC);
+    commonBranchLogic(!carry);
 }
 
-void CPU6502::BCS(std::function<u16()> resolvePC) {
+void CPU6502::BCS() {
     u8 carry = statusRegister & 1;
-    commonBranchLogic(carry, resolvePC);
+    commonBranchLogic(carry);
 }
 
-void CPU6502::BEQ(std::function<u16()> resolvePC) {
+void CPU6502::BEQ() {
     u8 zero = (statusRegister >> 1) & 1;
-    commonBranchLogic(zero, resolvePC);
+    commonBranchLogic(zero);
 }
 
-void CPU6502::BMI(std::function<u16()> resolvePC) {
+void CPU6502::BMI() {
     u8 neg = (statusRegister >> 7) & 1;
-    commonBranchLogic(neg, resolvePC);
+    commonBranchLogic(neg);
 }
 
-void CPU6502::BNE(std::function<u16()> resolvePC) {
+void CPU6502::BNE() {
     u8 zero = (statusRegister >> 1) & 1;
-    commonBranchLogic(!zero, resolvePC);
+    commonBranchLogic(!zero);
 }
 
-void CPU6502::BPL(std::function<u16()> resolvePC) {
+void CPU6502::BPL() {
     u8 neg = (statusRegister >> 7) & 1;
-    commonBranchLogic(!neg, resolvePC);
+    commonBranchLogic(!neg);
 }
 
-void CPU6502::BVC(std::function<u16()> resolvePC) {
+void CPU6502::BVC() {
     u8 overflow = (statusRegister >> 6) & 1;
-    commonBranchLogic(!overflow, resolvePC);
+    commonBranchLogic(!overflow);
 }
 
-void CPU6502::BVS(std::function<u16()> resolvePC) {
+void CPU6502::BVS() {
     u8 overflow = (statusRegister >> 6) & 1;
-    commonBranchLogic(overflow, resolvePC);
+    commonBranchLogic(overflow);
 }
 
-void CPU6502::BIT(std::function<u16()> addressing) {
-    u8 data = read(addressing());
+void CPU6502::BIT(u8 data) {
     u8 result = accumulator & data;
     u8 data_bit6 = (data >> 6) & 1;
     u8 data_bit7 = (data >> 7) & 1;
@@ -1170,10 +1220,6 @@ void CPU6502::CLV() {
     tick();
 }
 
-void CPU6502::CMP(std::function<u16()> addressing) {
-    CMP(read(addressing()));
-}
-
 void CPU6502::CMP(u8 data) {
     u8 cmp = accumulator - data;
     setCarry(accumulator >= data);
@@ -1181,29 +1227,26 @@ void CPU6502::CMP(u8 data) {
     setNegative(cmp & 0x80);
 }
 
-void CPU6502::CPX(std::function<u16()> addressing) {
-    u8 data = read(addressing());
+void CPU6502::CPX(u8 data) {
     u8 cmp = xRegister - data;
     setCarry(xRegister >= data);
     setZero(xRegister == data);
     setNegative(cmp & 0x80);
 }
 
-void CPU6502::CPY(std::function<u16()> addressing) {
-    u8 data = read(addressing());
+void CPU6502::CPY(u8 data) {
     u8 cmp = yRegister - data;
     setCarry(yRegister >= data);
     setZero(yRegister == data);
     setNegative(cmp & 0x80);
 }
 
-void CPU6502::DEC(std::function<u16()> addressing) {
-    u16 address = addressing();
-    u8 data = DEC(read(address));
+void CPU6502::DEC(u16 address) {
+    u8 data = DEC_val(read(address));
     write(address, data);
 }
 
-u8 CPU6502::DEC(u8 data) {
+u8 CPU6502::DEC_val(u8 data) {
     data--;
     setZero(data == 0);
     setNegative(data & 0x80);
@@ -1225,22 +1268,17 @@ void CPU6502::DEY() {
     tick();
 }
 
-void CPU6502::EOR(std::function<u16()> addressing) {
-    EOR(read(addressing()));
-}
-
 void CPU6502::EOR(u8 data) {
     accumulator ^= data;
     setZero(accumulator == 0);
     setNegative(accumulator & 0x80);
 }
 
-void CPU6502::INC(std::function<u16()> addressing) {
-    u16 address = addressing();
-    write(address, INC(read(address)));
+void CPU6502::INC(u16 address) {
+    write(address, INC_val(read(address)));
 }
 
-u8 CPU6502::INC(u8 data) {
+u8 CPU6502::INC_val(u8 data) {
     data = data + 1;
     setZero(data == 0);
     setNegative(data & 0x80);
@@ -1262,23 +1300,27 @@ void CPU6502::INY() {
     tick();
 }
 
-void CPU6502::JMP(std::function<u16()> addressing) {
-    //indirect
-    if (addressing == nullptr) {
-        u8 lsb = read(programCounter + 1);
-        u8 msb = read(programCounter + 2);
-        u16 address = msb * 256 + lsb;
-        u8 lsbt = read(address);
-        u16 msbAddress = (address & 0xFF) == 0xFF ? address & 0xFF00 : address + 1;
-        u8 msbt = read(msbAddress);
-        programCounter = msbt * 256 + lsbt - 1;
-    } else {
-        programCounter = addressing() - 1;
+void CPU6502::JMP(u16 address) {
+    u16 from = programCounter - 2;
+
+    if (idleLoopSkip && address <= from) {
+        idleLoopJump(from, address);
     }
+
+    programCounter = address - 1;
+}
+
+void CPU6502::JMPIndirect() {
+    u8 lsb = read(programCounter + 1);
+    u8 msb = read(programCounter + 2);
+    u16 address = msb * 256 + lsb;
+    u8 lsbt = read(address);
+    u16 msbAddress = (address & 0xFF) == 0xFF ? address & 0xFF00 : address + 1;
+    u8 msbt = read(msbAddress);
+    programCounter = msbt * 256 + lsbt - 1;
 }
 
-void CPU6502::JSR(std::function<u16()> addressing) {
-    u16 jumpAddress = addressing();
+void CPU6502::JSR(u16 jumpAddress) {
     u8 lsb = programCounter & 0xFF;
     u8 msb = programCounter >> 8;
     pushStack(msb);
@@ -1287,10 +1329,6 @@ void CPU6502::JSR(std::function<u16()> addressing) {
     tick();
 }
 
-void CPU6502::LDA(std::function<u16()> addressing) {
-    LDA(read(addressing()));
-}
-
 void CPU6502::LDA(u8 data) {
     accumulator = data;
     setZero(accumulator == 0);
@@ -1303,26 +1341,16 @@ void CPU6502::LDX(u8 data) {
     setNegative(xRegister & 0x80);
 }
 
-void CPU6502::LDX(std::function<u16()> addressing) {
-    LDX(read(addressing()));
-}
-
-void CPU6502::LDY(std::function<u16()> addressing) {
-    yRegister = read(addressing());
+void CPU6502::LDY(u8 data) {
+    yRegister = data;
     setZero(yRegister == 0);
     setNegative(yRegister & 0x80);
 }
 
-void CPU6502::LSR(std::function<u16()> addressing) {
-    if (addressing == nullptr) {
-        accumulator = LSR_val(accumulator);
-        tick();
-    } else {
-        u16 address = addressing();
-        u8 data = read(address);
-        write(address, LSR_val(data));
-        tick();
-    }
+void CPU6502::LSR(u16 address) {
+    u8 data = read(address);
+    write(address, LSR_val(data));
+    tick();
 }
 
 u8 CPU6502::LSR_val(u8 data) {
@@ -1334,17 +1362,12 @@ u8 CPU6502::LSR_val(u8 data) {
     return data;
 }
 
-void CPU6502::NOP(std::function<u16()> addressing) {
-    //Unofficial ones have addressing modes.
-    if (addressing != nullptr) {
-        addressing();
-    } else {
-        tick();
-    }
+void CPU6502::NOP() {
+    tick();
 }
 
-void CPU6502::ORA(std::function<u16()> addressing) {
-    ORA(read(addressing()));
+//Unofficial ones have addressing modes.
+void CPU6502::NOP(u16) {
 }
 
 void CPU6502::ORA(u8 data) {
@@ -1382,16 +1405,10 @@ void CPU6502::PLP() {
     tick();
 }
 
-void CPU6502::ROL(std::function<u16()> addressing) {
-    if (addressing == nullptr) {
-        accumulator = ROL_val(accumulator);
-        tick();
-    } else {
-        u16 address = addressing();
-        u8 data = ROL_val(read(address));
-        write(address, data);
-        tick();
-    }
+void CPU6502::ROL(u16 address) {
+    u8 data = ROL_val(read(address));
+    write(address, data);
+    tick();
 }
 
 u8 CPU6502::ROL_val(u8 data) {
@@ -1403,16 +1420,10 @@ u8 CPU6502::ROL_val(u8 data) {
     return data;
 }
 
-void CPU6502::ROR(std::function<u16()> addressing) {
-    if (addressing == nullptr) {
-        accumulator = ROR_val(accumulator);
-        tick();
-    } else {
-        u16 address = addressing();
-        u8 data = ROR_val(read(address));
-        write(address, data);
-        tick();
-    }
+void CPU6502::ROR(u16 address) {
+    u8 data = ROR_val(read(address));
+    write(address, data);
+    tick();
 }
 
 u8 CPU6502::ROR_val(u8 data) {
@@ -1444,10 +1455,6 @@ void CPU6502::RTS() {
     tick();
 }
 
-void CPU6502::SBC(std::function<u16()> addressing) {
-    SBC(read(addressing()));
-}
-
 void CPU6502::SBC(u8 data) {
     ADC(data ^ 0xFF);
 }
@@ -1467,16 +1474,16 @@ void CPU6502::SEI() {
     tick();
 }
 
-void CPU6502::STA(std::function<u16()> addressing) {
-    write(addressing(), accumulator);
+void CPU6502::STA(u16 address) {
+    write(address, accumulator);
 }
 
-void CPU6502::STX(std::function<u16()> addressing) {
-    write(addressing(), xRegister);
+void CPU6502::STX(u16 address) {
+    write(address, xRegister);
 }
 
-void CPU6502::STY(std::function<u16()> addressing) {
-    write(addressing(), yRegister);
+void CPU6502::STY(u16 address) {
+    write(address, yRegister);
 }
 
 void CPU6502::TAX() {
@@ -1521,36 +1528,32 @@ void CPU6502::TYA() {
 
 //UNOFFICIAL OPCODES
 //LDA+LDX
-void CPU6502::LAX(std::function<u16()> addressing) {
-    u8 data = read(addressing());
+void CPU6502::LAX(u8 data) {
     LDA(data);
     LDX(data);
 }
 
 //STA+acc&x
-void CPU6502::SAX(std::function<u16()> addressing) {
-    write(addressing(), accumulator & xRegister);
+void CPU6502::SAX(u16 address) {
+    write(address, accumulator & xRegister);
 }
 
 //DEC+CMP
-void CPU6502::DCP(std::function<u16()> addressing) {
-    u16 address = addressing();
-    u8 data = DEC(read(address));
+void CPU6502::DCP(u16 address) {
+    u8 data = DEC_val(read(address));
     write(address, data);
     CMP(data);
 }
 
 //INC+SBC
-void CPU6502::ISB(std::function<u16()> addressing) {
-    u16 address = addressing();
-    u8 data = INC(read(address));
+void CPU6502::ISB(u16 address) {
+    u8 data = INC_val(read(address));
     write(address, data);
     SBC(data);
 }
 
 //ASL+ORA
-void CPU6502::SLO(std::function<u16()> addressing) {
-    u16 address = addressing();
+void CPU6502::SLO(u16 address) {
     u8 data = ASL_val(read(address));
     write(address, data);
     ORA(data);
@@ -1558,8 +1561,7 @@ void CPU6502::SLO(std::function<u16()> addressing) {
 }
 
 //ROL+AND
-void CPU6502::RLA(std::function<u16()> addressing) {
-    u16 address = addressing();
+void CPU6502::RLA(u16 address) {
     u8 data = ROL_val(read(address));
     write(address, data);
     AND(data);
@@ -1567,8 +1569,7 @@ void CPU6502::RLA(std::function<u16()> addressing) {
 }
 
 //LSR+EOR
-void CPU6502::SRE(std::function<u16()> addressing) {
-    u16 address = addressing();
+void CPU6502::SRE(u16 address) {
     u8 data = LSR_val(read(address));
     write(address, data);
     EOR(data);
@@ -1576,8 +1577,7 @@ void CPU6502::SRE(std::function<u16()> addressing) {
 }
 
 //ROR+ADC
-void CPU6502::RRA(std::function<u16()> addressing) {
-    u16 address = addressing();
+void CPU6502::RRA(u16 address) {
     u8 data = ROR_val(read(address));
     write(address, data);
     ADC(data);
@@ -2,19 +2,30 @@
 
 #include <stdio.h>
 
-#include <functional>
 #include <iostream>
 #include <sstream>
 #include <vector>
 
+#include "BlockCache.hpp"
+#include "Common/PageTable.hpp"
+#include "Common/ScopedTimer.hpp"
 #include "Common/Typedefs.hpp"
 #include "Controller.hpp"
+#include "Jit.hpp"
 #include "Mapper/Mapper.hpp"
 #include "PPU.hpp"
 #include "RAM.hpp"
+#include "SaveState.hpp"
+#include "Scheduler.hpp"
 
 namespace MedNES {
 
+//Wall clock nanoseconds spent outside the CPU, CHR fetches count as PPU time
+struct SubsystemTimes {
+    u64 ppu = 0;
+    u64 mapper = 0;
+};
+
 struct ExecutionState {
     u8 accumulator;
     u8 xRegister;
@@ -22,7 +33,7 @@ struct ExecutionState {
     u16 programCounter;
     u8 stackPointer;
     u8 statusRegister;
-    int cycle;
+    u64 cycle;
 };
 
 class CPU6502 {
@@ -42,8 +53,24 @@ class CPU6502 {
         CARRY = 0
     };
 
+    enum AddressingMode {
+        IMMEDIATE,
+        ZERO_PAGE,
+        ZERO_PAGE_X,
+        ZERO_PAGE_Y,
+        ABSOLUTE,
+        ABSOLUTE_X,
+        ABSOLUTE_Y,
+        INDIRECT_X,
+        INDIRECT_Y
+    };
+
+    typedef void (CPU6502::*OpcodeHandler)();
+
    public:
-    CPU6502(Mapper *mapper, PPU *ppu, Controller *controller) : mapper(mapper), ppu(ppu), controller(controller){};
+    CPU6502(Mapper *mapper, PPU *ppu, Controller *controller);
+    CPU6502(const CPU6502 &) = delete;
+    CPU6502 &operator=(const CPU6502 &) = delete;
     u8 fetchInstruction();
     void executeInstruction(u8 instruction);
     u8 memoryAccess(MemoryAccessMode mode, u16 address, u8 data);
@@ -55,7 +82,35 @@ class CPU6502 {
     void setProgramCounter(u16 pc);
     ExecutionState *getExecutionState();
 
+    //Run from predecoded blocks instead of decoding every instruction
+    void setBlockCache(bool enabled);
+    const BlockCache &getBlockCache() { return blockCache; }
+
+    //Translate hot blocks to native code, false when the JIT is not built in
+    bool setJit(bool enabled);
+#ifdef MEDNES_HAS_JIT
+    Jit &getJit() { return jit; }
+#endif
+
+    //Snapshot the CPU and every device connected to it. loadState fails on a
+    //state from another version or another cartridge and leaves it untouched.
+    void saveState(SaveState &);
+    bool loadState(const SaveState &);
+
+    //Fast-forward loops that only wait for the next event, off by default
+    void setIdleLoopSkip(bool enabled);
+    u64 getSkippedCycles() { return skippedCycles; }
+
+    //Time PPU catch-up and mapper calls, off by default
+    void setProfiling(bool enabled) { profiling = enabled; }
+    const SubsystemTimes &getSubsystemTimes() { return times; }
+    u64 getInstructionCount() { return instructions; }
+
    private:
+#ifdef MEDNES_HAS_JIT
+    friend class Jit;
+#endif
+
     //Arithmetic
     u8 accumulator = 0;
     u8 xRegister = 0;
@@ -66,16 +121,58 @@ class CPU6502 {
     u8 stackPointer = 0xFD;
     u8 statusRegister = 0x24;
 
-    int cycle = 7;
+    //master clock and timed events, the PPU is caught up to it lazily
+    Scheduler scheduler;
 
     //Devices
     RAM ram;
+    PageTable pageTable;
     Mapper *mapper;
     PPU *ppu;
     Controller *controller;
 
     std::stringstream execLog;
 
+    //Profiling
+    u64 instructions = 0;
+    bool profiling = false;
+    SubsystemTimes times;
+
+    //Cached interpreter
+    BlockCache blockCache;
+    bool codeWatch[256] = {false};
+    bool blockAborted = false;
+
+    //Idle loop skipping: a short backward loop of read-only instructions that
+    //comes back to the same registers twice is waiting for an event
+    static const int MAX_IDLE_LOOP_BYTES = 16;
+
+    struct IdleLoop {
+        bool armed = false;
+        u16 start = 0;
+        u16 rejected = 0;
+        bool sideEffects = false;
+        bool readsStatus = false;
+        u8 status = 0;
+        u64 clock = 0;
+        u64 instructions = 0;
+        u8 accumulator = 0;
+        u8 xRegister = 0;
+        u8 yRegister = 0;
+        u8 stackPointer = 0;
+        u8 statusRegister = 0;
+    };
+
+    bool idleLoopSkip = false;
+    IdleLoop idleLoop;
+    u64 skippedCycles = 0;
+
+#ifdef MEDNES_HAS_JIT
+    Jit jit;
+
+    NativeBlock translate(Block &);
+#endif
+
     inline void setSRFlag(StatusFlags, bool);
     inline void setNegative(bool);
     inline void setOverflow(bool);
@@ -100,75 +197,106 @@ class CPU6502 {
 
     inline void tick();
 
+    inline void syncPPU();
+
+    void serviceEvents();
+
+    inline void interpretInstruction();
+    inline void executeBlock();
+    Block *decodeBlock(const u8 *page);
+    void codeWritten(u16 address);
+
+    void idleLoopJump(u16 from, u16 target);
+    bool isIdleLoopBody(u16 start, u16 end);
+    void armIdleLoop(u16 start);
+    void skipIdleLoop();
+
     //stack
     void pushStack(u8);
 
     u8 popStack();
 
     //addressing
-    u16 immediate();
+    inline u16 immediate();
 
-    u16 zeroPage();
+    inline u16 zeroPage();
 
-    u16 zeroPageX();
+    inline u16 zeroPageX();
 
-    u16 zeroPageY();
+    inline u16 zeroPageY();
 
-    u16 absolute();
+    inline u16 absolute();
 
-    u16 absoluteX(bool);
+    inline u16 absoluteX(bool);
 
-    u16 absoluteY(bool);
+    inline u16 absoluteY(bool);
 
-    u16 indirectX();
+    inline u16 indirectX();
 
-    u16 indirectY(bool);
+    inline u16 indirectY(bool);
 
-    u16 relative();
+    inline u16 relative();
 
-    void ADC(std::function<u16()>);
+    //opcode dispatch
+    static const OpcodeHandler opcodeTable[256];
+    static const u8 opcodeLengths[256];
 
-    void ADC(u8);  //for RRA
+    template <AddressingMode mode, bool pageCrossTick>
+    inline u16 resolveAddress();
 
-    //And with accumulator
-    void AND(std::function<u16()>);
+    //Read the operand and pass its value to op
+    template <void (CPU6502::*op)(u8), AddressingMode mode, bool pageCrossTick = false, int dummyTicks = 0>
+    void readOp();
+
+    //Pass the effective address to op (stores, read-modify-write, jumps)
+    template <void (CPU6502::*op)(u16), AddressingMode mode, bool pageCrossTick = false, int dummyTicks = 0>
+    void addressOp();
 
-    void AND(u8);  //for RLA
+    template <u8 (CPU6502::*op)(u8)>
+    void accumulatorOp();
+
+    template <u8 opcode>
+    void unknownOpcode();
+
+    void ADC(u8);
+
+    //And with accumulator
+    void AND(u8);
 
     //Arithmetic shift left
-    void ASL(std::function<u16()>);
+    void ASL(u16);
 
-    u8 ASL_val(u8);  //for SLO
+    u8 ASL_val(u8);
 
     //Branch on carry clear
-    void BCC(std::function<u16()>);
+    void BCC();
 
     //branch on carry set
-    void BCS(std::function<u16()>);
+    void BCS();
 
     //branch on equal (zero set)
-    void BEQ(std::function<u16()>);
+    void BEQ();
 
     //Bit test
-    void BIT(std::function<u16()>);
+    void BIT(u8);
 
     //Branch on minus (negative set)
-    void BMI(std::function<u16()>);
+    void BMI();
 
     //Branch on not equal (zero clear)
-    void BNE(std::function<u16()>);
+    void BNE();
 
     //Branch on plus (negative clear)
-    void BPL(std::function<u16()>);
+    void BPL();
 
     //Interrupt
     void BRK();
 
     //Branch on overflow clear
-    void BVC(std::function<u16()>);
+    void BVC();
 
     //Branch on overflow set
-    void BVS(std::function<u16()>);
+    void BVS();
 
     //Clear carry
     void CLC();
@@ -183,20 +311,18 @@ class CPU6502 {
     void CLV();
 
     //Compare (with accumulator}
-    void CMP(std::function<u16()>);
-
-    void CMP(u8);  //for DCP
+    void CMP(u8);
 
     //Compare with X
-    void CPX(std::function<u16()>);
+    void CPX(u8);
 
     //Compare with Y
-    void CPY(std::function<u16()>);
+    void CPY(u8);
 
     //Decrement
-    void DEC(std::function<u16()>);
+    void DEC(u16);
 
-    u8 DEC(u8);  //for DCP
+    u8 DEC_val(u8);  //for DCP
 
     //decrement X
     void DEX();
@@ -205,14 +331,12 @@ class CPU6502 {
     void DEY();
 
     //Exclusive or (with accumulator)
-    void EOR(std::function<u16()>);
-
-    void EOR(u8);  //for SRE
+    void EOR(u8);
 
     //Increment
-    void INC(std::function<u16()>);
+    void INC(u16);
 
-    u8 INC(u8);  //for ISB
+    u8 INC_val(u8);  //for ISB
 
     //Increment X
     void INX();
@@ -221,33 +345,29 @@ class CPU6502 {
     void INY();
 
     //Jump
-    void JMP(std::function<u16()>);
+    void JMP(u16);
+
+    void JMPIndirect();
 
     //Jump subroutine
-    void JSR(std::function<u16()>);
+    void JSR(u16);
 
     //Load accumulator
-    void LDA(std::function<u16()>);
-
-    void LDA(u8);  //for LAX
+    void LDA(u8);
 
     //Load X
-    void LDX(std::function<u16()>);
-
-    void LDX(u8);  //for LAX
+    void LDX(u8);
 
     //Load Y
-    void LDY(std::function<u16()>);
+    void LDY(u8);
 
     //Logical shift right
-    void LSR(std::function<u16()>);
+    void LSR(u16);
 
     u8 LSR_val(u8);  //for SRE
 
     //Or with accumulator
-    void ORA(std::function<u16()>);
-
-    void ORA(u8);  //for SLO
+    void ORA(u8);
 
     //Push accumulator
     void PHA();
@@ -262,12 +382,12 @@ class CPU6502 {
     void PLP();
 
     //Rotate left
-    void ROL(std::function<u16()>);
+    void ROL(u16);
 
     u8 ROL_val(u8);
 
     //Rotate right
-    void ROR(std::function<u16()>);
+    void ROR(u16);
 
     u8 ROR_val(u8);  //for RRA
 
@@ -278,9 +398,7 @@ class CPU6502 {
     void RTS();
 
     //Subtract with carrz
-    void SBC(std::function<u16()>);
-
-    void SBC(u8);  //for ISB
+    void SBC(u8);
 
     //Set carry
     void SEC();
@@ -292,13 +410,13 @@ class CPU6502 {
     void SEI();
 
     //Store accumulator
-    void STA(std::function<u16()>);
+    void STA(u16);
 
     //Store X
-    void STX(std::function<u16()>);
+    void STX(u16);
 
     //Store Y
-    void STY(std::function<u16()>);
+    void STY(u16);
 
     //Transfer accumulator to X
     void TAX();
@@ -319,25 +437,27 @@ class CPU6502 {
     void TYA();
 
     //UNOFFICIAL ONES
-    void NOP(std::function<u16()>);
+    void NOP();
+
+    void NOP(u16);
 
-    void LAX(std::function<u16()>);
+    void LAX(u8);
 
-    void SAX(std::function<u16()>);
+    void SAX(u16);
 
-    void DCP(std::function<u16()>);
+    void DCP(u16);
 
-    void ISB(std::function<u16()>);
+    void ISB(u16);
 
-    void SLO(std::function<u16()>);
+    void SLO(u16);
 
-    void RLA(std::function<u16()>);
+    void RLA(u16);
 
-    void RRA(std::function<u16()>);
+    void RRA(u16);
 
-    void SRE(std::function<u16()>);
+    void SRE(u16);
 
-    void commonBranchLogic(bool, std::function<u16()>);
+    void commonBranchLogic(bool);
 
     void tickIfToNewPage(u16, u16);
 
@@ -0,0 +1,92 @@
+#include "BlockCache.hpp"
+
+#include <stdint.h>
+
+namespace MedNES {
+
+void BlockCache::enable() {
+    blocks.assign(SLOTS, Block());
+    rewrites.clear();
+    hits = misses = invalidations = 0;
+}
+
+void BlockCache::disable() {
+    std::vector<Block>().swap(blocks);
+    rewrites.clear();
+}
+
+inline Block &BlockCache::slot(const u8 *code) {
+    uintptr_t key = (uintptr_t)code;
+    return blocks[(key ^ (key >> 12)) & (SLOTS - 1)];
+}
+
+Block *BlockCache::find(const u8 *code) {
+    Block &block = slot(code);
+
+    if (block.code == code) {
+        hits++;
+        return &block;
+    }
+
+    misses++;
+    return nullptr;
+}
+
+Block *BlockCache::allocate(const u8 *code, const u8 *page) {
+    Block &block = slot(code);
+    block.code = code;
+    block.page = page;
+    block.count = 0;
+    block.writable = false;
+    block.native = nullptr;
+    block.runs = 0;
+    return &block;
+}
+
+void BlockCache::invalidatePage(const u8 *page) {
+    for (Block &block : blocks) {
+        if (block.page == page) {
+            block.code = nullptr;
+            block.page = nullptr;
+        }
+    }
+
+    invalidations++;
+
+    for (PageRewrites &entry : rewrites) {
+        if (entry.page == page) {
+            entry.count++;
+            return;
+        }
+    }
+
+    rewrites.push_back({page, 1});
+}
+
+void BlockCache::invalidateWritable() {
+    for (Block &block : blocks) {
+        if (block.writable) {
+            block.code = nullptr;
+            block.page = nullptr;
+        }
+    }
+}
+
+void BlockCache::dropNativeCode() {
+    for (Block &block : blocks) {
+        block.native = nullptr;
+        block.runs = 0;
+    }
+}
+
+bool BlockCache::isVolatile(const u8 *page) {
+    for (const PageRewrites &entry : rewrites) {
+        if (entry.page == page) {
+            return entry.count >= VOLATILE_THRESHOLD;
+        }
+    }
+
+    return false;
+}
+
+}  //namespace MedNES
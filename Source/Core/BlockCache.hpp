@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+
+#include "Common/Typedefs.hpp"
+
+namespace MedNES {
+
+class CPU6502;
+
+typedef void (*NativeBlock)(CPU6502 *);
+
+//Straight-line run of predecoded instructions. Blocks stop at control flow
+//and never cross a 256 byte page, so the page they were decoded from
+//identifies them regardless of where the mapper currently puts it.
+struct Block {
+    static const int MAX_OPS = 16;
+
+    const u8 *code = nullptr;
+    const u8 *page = nullptr;
+    int count = 0;
+    void (CPU6502::*ops[MAX_OPS])();
+
+    //decoded from memory the CPU can write
+    bool writable = false;
+
+    //JIT translation, made once the block has run often enough
+    NativeBlock native = nullptr;
+    int runs = 0;
+};
+
+//Direct-mapped cache of blocks keyed by the host address of their first byte
+class BlockCache {
+   public:
+    void enable();
+    void disable();
+    bool isEnabled() { return !blocks.empty(); }
+
+    Block *find(const u8 *code);
+    Block *allocate(const u8 *code, const u8 *page);
+
+    //Drop every block decoded from page after code in it was overwritten
+    void invalidatePage(const u8 *page);
+
+    //Drop every block decoded from writable memory, its contents were replaced
+    void invalidateWritable();
+
+    //Forget all JIT translations, the code buffer is being reused
+    void dropNativeCode();
+
+    //Pages that keep getting rewritten are left to the interpreter
+    bool isVolatile(const u8 *page);
+
+    u64 hits = 0;
+    u64 misses = 0;
+    u64 invalidations = 0;
+
+   private:
+    static const int SLOTS = 4096;
+    static const int VOLATILE_THRESHOLD = 16;
+
+    struct PageRewrites {
+        const u8 *page;
+        int count;
+    };
+
+    std::vector<Block> blocks;
+    std::vector<PageRewrites> rewrites;
+
+    inline Block &slot(const u8 *code);
+};
+
+};  //namespace MedNES
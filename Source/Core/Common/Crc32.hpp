@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "Typedefs.hpp"
+
+namespace MedNES {
+
+//CRC-32 as zip and the ROM databases use it, 8 bytes at a time with one
+//table per byte position (slicing by 8)
+class Crc32 {
+   public:
+    //crc is the result for the bytes before, to continue over several buffers
+    static u32 compute(const u8 *data, size_t size, u32 crc = 0) {
+        static const Tables tables;
+        const u32(&t)[8][256] = tables.t;
+        crc = ~crc;
+
+        for (; size >= 8; data += 8, size -= 8) {
+            u32 one = crc ^ (data[0] | data[1] << 8 | data[2] << 16 | (u32)data[3] << 24);
+            u32 two = data[4] | data[5] << 8 | data[6] << 16 | (u32)data[7] << 24;
+            crc = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^ t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24] ^
+                  t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^ t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+        }
+
+        for (; size > 0; data++, size--) {
+            crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xFF];
+        }
+
+        return ~crc;
+    }
+
+   private:
+    //t[0] is the plain bytewise table, t[n] is a byte followed by n zero bytes
+    struct Tables {
+        u32 t[8][256];
+
+        Tables() {
+            for (u32 i = 0; i < 256; i++) {
+                u32 crc = i;
+
+                for (int bit = 0; bit < 8; bit++) {
+                    crc = (crc >> 1) ^ (crc & 1 ? 0xEDB88320 : 0);
+                }
+
+                t[0][i] = crc;
+            }
+
+            for (u32 i = 0; i < 256; i++) {
+                for (int n = 1; n < 8; n++) {
+                    t[n][i] = (t[n - 1][i] >> 8) ^ t[0][t[n - 1][i] & 0xFF];
+                }
+            }
+        }
+    };
+};
+
+};  //namespace MedNES
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "Typedefs.hpp"
+
+namespace MedNES {
+
+struct FramePacingStats {
+    u64 presented;
+    //presents that showed the previous frame again
+    u64 repeated;
+    //frame time percentiles in ms, 0 until two new frames were shown
+    double p50;
+    double p99;
+};
+
+//Counts what the presenting side shows. Frame time is the time between two
+//new frames reaching the screen, over the last WINDOW of them.
+class FramePacing {
+   public:
+    typedef std::chrono::steady_clock Clock;
+
+    static const int WINDOW = 600;
+
+    //One present, newFrame if it showed a frame not shown before
+    void present(bool newFrame, Clock::time_point when = Clock::now()) {
+        presented++;
+
+        if (!newFrame) {
+            repeated++;
+            return;
+        }
+
+        if (hasLastFrame) {
+            double ms = std::chrono::duration<double, std::milli>(when - lastFrame).count();
+
+            if (frameTimes.size() < (size_t)WINDOW) {
+                frameTimes.push_back(ms);
+            } else {
+                frameTimes[next] = ms;
+            }
+
+            next = (next + 1) % WINDOW;
+        }
+
+        lastFrame = when;
+        hasLastFrame = true;
+    }
+
+    FramePacingStats stats() const {
+        FramePacingStats stats = {presented, repeated, 0, 0};
+
+        if (!frameTimes.empty()) {
+            std::vector<double> sorted = frameTimes;
+            std::sort(sorted.begin(), sorted.end());
+            stats.p50 = sorted[(sorted.size() - 1) * 50 / 100];
+            stats.p99 = sorted[(sorted.size() - 1) * 99 / 100];
+        }
+
+        return stats;
+    }
+
+   private:
+    u64 presented = 0;
+    u64 repeated = 0;
+    std::vector<double> frameTimes;
+    size_t next = 0;
+    Clock::time_point lastFrame;
+    bool hasLastFrame = false;
+};
+
+};  //namespace MedNES
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Typedefs.hpp"
+
+namespace MedNES {
+
+//The four logical nametables at $2000-$2FFF, each pointing at a 1kb page of
+//VRAM. The PPU owns VRAM, the mapper lays the pages out whenever its
+//mirroring changes, so a nametable access is a shift and two indexes.
+class NametableMap {
+   public:
+    NametableMap(u8 *vram) : vram(vram) { mirror(0); }
+
+    //0 horizontal, 1 vertical, 2 one screen lower, 3 one screen upper
+    void mirror(int mirroring) {
+        static const u8 layouts[4][4] = {
+            {0, 0, 1, 1},
+            {0, 1, 0, 1},
+            {0, 0, 0, 0},
+            {1, 1, 1, 1},
+        };
+
+        for (int i = 0; i < 4; i++) {
+            pages[i] = vram + layouts[mirroring & 3][i] * 0x400;
+        }
+    }
+
+    //Any address in $2000-$3EFF
+    u8 &at(u16 address) { return pages[(address >> 10) & 3][address & 0x3FF]; }
+
+   private:
+    u8 *vram;
+    u8 *pages[4];
+};
+
+};  //namespace MedNES
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Typedefs.hpp"
+
+namespace MedNES {
+
+//CPU address space split into 256 byte pages. A page that points to memory
+//is accessed directly (RAM mirrors, mapped PRG banks), a null page goes through
+//the I/O path (PPU, APU/controller registers, mapper registers).
+struct PageTable {
+    const u8 *read[256] = {nullptr};
+    u8 *write[256] = {nullptr};
+
+    void map(u16 address, u32 size, const u8 *readData, u8 *writeData) {
+        for (u32 i = 0; i < size / 256; i++) {
+            read[(address >> 8) + i] = readData ? readData + i * 256 : nullptr;
+            write[(address >> 8) + i] = writeData ? writeData + i * 256 : nullptr;
+        }
+    }
+
+    void unmap(u16 address, u32 size) {
+        map(address, size, nullptr, nullptr);
+    }
+};
+
+};  //namespace MedNES
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+
+#include "Typedefs.hpp"
+
+namespace MedNES {
+
+//Adds the nanoseconds spent in its scope to total, does nothing when total is null
+class ScopedTimer {
+   public:
+    ScopedTimer(u64 *total) : total(total) {
+        if (total != nullptr) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+    ~ScopedTimer() {
+        if (total != nullptr) {
+            *total += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+
+   private:
+    u64 *total;
+    std::chrono::steady_clock::time_point start;
+};
+
+};  //namespace MedNES
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+
+#include <array>
+
+#include "Typedefs.hpp"
+
+namespace MedNES {
+
+//SHA-1, for ROM identity only. It's what No-Intro and the other ROM
+//databases list next to CRC-32.
+class Sha1 {
+   public:
+    typedef std::array<u8, 20> Digest;
+
+    static Digest compute(const u8 *data, size_t size) {
+        u32 h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+        size_t whole = size & ~(size_t)63;
+
+        for (size_t offset = 0; offset < whole; offset += 64) {
+            block(h, data + offset);
+        }
+
+        //the rest, a 1 bit, zeros and the length in bits, in one or two blocks
+        u8 tail[128] = {0};
+        size_t rest = size - whole;
+        memcpy(tail, data + whole, rest);
+        tail[rest] = 0x80;
+        size_t tailSize = rest < 56 ? 64 : 128;
+        u64 bits = (u64)size * 8;
+
+        for (int i = 0; i < 8; i++) {
+            tail[tailSize - 1 - i] = bits >> (i * 8);
+        }
+
+        for (size_t offset = 0; offset < tailSize; offset += 64) {
+            block(h, tail + offset);
+        }
+
+        Digest digest;
+
+        for (int i = 0; i < 20; i++) {
+            digest[i] = h[i / 4] >> (24 - (i % 4) * 8);
+        }
+
+        return digest;
+    }
+
+   private:
+    static u32 rotate(u32 value, int bits) { return (value << bits) | (value >> (32 - bits)); }
+
+    //One round with a-e renamed instead of moved, after five rounds they
+    //are back in place. stage picks the round function and constant.
+    template <int stage>
+    static void round(u32 a, u32 &b, u32 c, u32 d, u32 &e, u32 w) {
+        static const u32 k[4] = {0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6};
+        u32 f = stage == 0 ? (b & c) | (~b & d) : stage == 2 ? (b & c) | (b & d) | (c & d) : b ^ c ^ d;
+        e += rotate(a, 5) + f + k[stage] + w;
+        b = rotate(b, 30);
+    }
+
+    template <int stage>
+    static void rounds(u32 &a, u32 &b, u32 &c, u32 &d, u32 &e, const u32 *w) {
+        for (int i = 0; i < 20; i += 5) {
+            round<stage>(a, b, c, d, e, w[i]);
+            round<stage>(e, a, b, c, d, w[i + 1]);
+            round<stage>(d, e, a, b, c, w[i + 2]);
+            round<stage>(c, d, e, a, b, w[i + 3]);
+            round<stage>(b, c, d, e, a, w[i + 4]);
+        }
+    }
+
+    static void block(u32 h[5], const u8 *data) {
+        u32 w[80];
+
+        for (int i = 0; i < 16; i++) {
+            w[i] = (u32)data[i * 4] << 24 | data[i * 4 + 1] << 16 | data[i * 4 + 2] << 8 | data[i * 4 + 3];
+        }
+
+        for (int i = 16; i < 80; i++) {
+            w[i] = rotate(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        u32 a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+
+        rounds<0>(a, b, c, d, e, w);
+        rounds<1>(a, b, c, d, e, w + 20);
+        rounds<2>(a, b, c, d, e, w + 40);
+        rounds<3>(a, b, c, d, e, w + 60);
+
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+};
+
+};  //namespace MedNES
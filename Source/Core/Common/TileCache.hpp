@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+
+#include "Typedefs.hpp"
+
+namespace MedNES {
+
+//One 8 pixel row of a CHR tile. The bit planes as stored, and the 2-bit
+//pixel indices with the leftmost pixel in the top bits, plain and mirrored.
+struct TileRow {
+    u8 lo;
+    u8 hi;
+    u16 pixels;
+    u16 flipped;
+};
+
+//CHR decoded into tile rows. Rows are keyed by offset into CHR, so every bank
+//is decoded once and a bank switch only moves a window. The mapper points the
+//eight 1kb pattern windows at its current banks and reports CHR writes.
+class TileCache {
+   public:
+    //Decode all of CHR, at load and whenever it's replaced as a whole
+    void load(const u8 *chr, u32 size) {
+        rows.resize(size / 2);
+
+        for (u32 offset = 0; offset < size; offset += 16) {
+            for (u32 line = 0; line < 8; line++) {
+                rows[offset / 2 + line] = decode(chr[offset + line], chr[offset + line + 8]);
+            }
+        }
+
+        for (auto &window : windows) {
+            window = rows.data();
+        }
+    }
+
+    //A byte of CHR changed, redecode the row it belongs to
+    void write(u32 offset, const u8 *chr) {
+        u32 tile = offset & ~0xF;
+        u32 line = offset & 7;
+        rows[tile / 2 + line] = decode(chr[tile + line], chr[tile + line + 8]);
+    }
+
+    //Point size bytes of pattern space at address to CHR at chrOffset
+    void map(u16 address, u32 size, u32 chrOffset) {
+        for (u32 i = 0; i < size / 0x400; i++) {
+            u32 offset = (chrOffset + i * 0x400) % (rows.size() * 2);
+            windows[(address >> 10) + i] = &rows[offset / 2];
+        }
+    }
+
+    //The row holding pattern address, either bit plane
+    const TileRow &row(u16 address) const {
+        return windows[(address >> 10) & 7][((address & 0x3F0) >> 1) | (address & 7)];
+    }
+
+    static TileRow decode(u8 lo, u8 hi) {
+        u16 pixels = spread(lo) | (spread(hi) << 1);
+        u16 flipped = spread(reverse(lo)) | (spread(reverse(hi)) << 1);
+        return {lo, hi, pixels, flipped};
+    }
+
+   private:
+    //bit n to bit 2n
+    static u16 spread(u16 bits) {
+        bits = (bits | (bits << 4)) & 0x0F0F;
+        bits = (bits | (bits << 2)) & 0x3333;
+        return (bits | (bits << 1)) & 0x5555;
+    }
+
+    static u8 reverse(u8 bits) {
+        bits = (bits >> 4) | (bits << 4);
+        bits = ((bits & 0xCC) >> 2) | ((bits & 0x33) << 2);
+        return ((bits & 0xAA) >> 1) | ((bits & 0x55) << 1);
+    }
+
+    std::vector<TileRow> rows;
+    const TileRow *windows[8] = {nullptr};
+};
+
+};  //namespace MedNES
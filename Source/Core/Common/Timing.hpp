@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Typedefs.hpp"
+
+namespace MedNES {
+
+//NTSC timing, everything is measured in master clock cycles (21.477272 MHz)
+constexpr u64 MASTER_CLOCK_HZ = 21477272;
+constexpr u64 CPU_CLOCK_DIVIDER = 12;
+constexpr u64 PPU_CLOCK_DIVIDER = 4;
+
+constexpr int DOTS_PER_SCANLINE = 341;
+constexpr int SCANLINES_PER_FRAME = 262;
+
+};  //namespace MedNES
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include "Typedefs.hpp"
+
+namespace MedNES {
+
+//Hands whole frames from one producer thread to one consumer thread without
+//locks. Each side owns a buffer and the third holds the newest published
+//frame, so the producer never waits and the consumer always gets the latest
+//complete frame. A frame published over one nobody picked up drops that one.
+template <typename T>
+class TripleBuffer {
+   public:
+    TripleBuffer(size_t size) {
+        for (auto &buffer : buffers) {
+            buffer.resize(size);
+        }
+    }
+
+    TripleBuffer(const TripleBuffer &) = delete;
+    TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+    //Producer side, the buffer to fill
+    T *back() { return buffers[backIndex].data(); }
+
+    //Producer side, hand the filled buffer over and get a free one
+    void publish() {
+        u8 previous = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel);
+        backIndex = previous & INDEX;
+
+        if (previous & FRESH) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    //Consumer side, switch to the newest published frame. False if nothing
+    //was published since the last call and front() is the same frame.
+    bool acquire() {
+        //only the consumer clears FRESH, so it is still set at the exchange
+        if (!(middle.load(std::memory_order_acquire) & FRESH)) {
+            return false;
+        }
+
+        frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    //Consumer side, the frame acquired last
+    const T *front() const { return buffers[frontIndex].data(); }
+
+    //Frames published and never acquired, from either thread
+    u64 getDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+   private:
+    static const u8 INDEX = 3;
+    static const u8 FRESH = 4;
+
+    std::vector<T> buffers[3];
+    //index of the buffer in between, FRESH if it wasn't acquired yet
+    std::atomic<u8> middle{1};
+    u8 backIndex = 0;
+    u8 frontIndex = 2;
+    std::atomic<u64> dropped{0};
+};
+
+};  //namespace MedNES
@@ -0,0 +1,265 @@
+#include "Compositor.hpp"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace MedNES {
+
+bool composeLineScalar(const LineLayers &layers, bool showBg, bool showSprites, u8 *out) {
+    bool hit = false;
+
+    for (int i = 0; i < 256; i++) {
+        u8 bg = layers.background[i];
+        u8 sprite = layers.sprite[i];
+        u8 flags = layers.spriteFlags[i];
+        bool bgOpaque = bg & 3;
+
+        if (sprite && bgOpaque && (flags & LineLayers::SPRITE_ZERO)) {
+            hit = true;
+        }
+
+        if (sprite && showSprites && (!bgOpaque || !(flags & LineLayers::BEHIND_BACKGROUND))) {
+            out[i] = sprite;
+        } else {
+            out[i] = showBg ? bg : 0;
+        }
+    }
+
+    return hit && showBg && showSprites;
+}
+
+#if defined(__AVX2__)
+
+bool composeLine(const LineLayers &layers, bool showBg, bool showSprites, u8 *out) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i three = _mm256_set1_epi8(3);
+    const __m256i behindBit = _mm256_set1_epi8(LineLayers::BEHIND_BACKGROUND);
+    const __m256i zeroBit = _mm256_set1_epi8(LineLayers::SPRITE_ZERO);
+    const __m256i bgMask = _mm256_set1_epi8(showBg ? -1 : 0);
+    const __m256i spriteMask = _mm256_set1_epi8(showSprites ? -1 : 0);
+    __m256i hits = zero;
+
+    for (int i = 0; i < 256; i += 32) {
+        __m256i bg = _mm256_loadu_si256((const __m256i *)&layers.background[i]);
+        __m256i sprite = _mm256_loadu_si256((const __m256i *)&layers.sprite[i]);
+        __m256i flags = _mm256_loadu_si256((const __m256i *)&layers.spriteFlags[i]);
+
+        //all ones where transparent or not set
+        __m256i bgClear = _mm256_cmpeq_epi8(_mm256_and_si256(bg, three), zero);
+        __m256i spriteClear = _mm256_cmpeq_epi8(sprite, zero);
+        __m256i front = _mm256_cmpeq_epi8(_mm256_and_si256(flags, behindBit), zero);
+        __m256i spriteZero = _mm256_cmpeq_epi8(_mm256_and_si256(flags, zeroBit), zeroBit);
+
+        hits = _mm256_or_si256(hits, _mm256_andnot_si256(_mm256_or_si256(spriteClear, bgClear), spriteZero));
+
+        __m256i showSprite = _mm256_andnot_si256(spriteClear, _mm256_and_si256(_mm256_or_si256(front, bgClear), spriteMask));
+        __m256i pixel = _mm256_or_si256(_mm256_and_si256(showSprite, sprite),
+                                        _mm256_andnot_si256(showSprite, _mm256_and_si256(bg, bgMask)));
+        _mm256_storeu_si256((__m256i *)&out[i], pixel);
+    }
+
+    return _mm256_movemask_epi8(hits) != 0 && showBg && showSprites;
+}
+
+const char *compositorName() {
+    return "avx2";
+}
+
+#elif defined(__SSE2__)
+
+bool composeLine(const LineLayers &layers, bool showBg, bool showSprites, u8 *out) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i three = _mm_set1_epi8(3);
+    const __m128i behindBit = _mm_set1_epi8(LineLayers::BEHIND_BACKGROUND);
+    const __m128i zeroBit = _mm_set1_epi8(LineLayers::SPRITE_ZERO);
+    const __m128i bgMask = _mm_set1_epi8(showBg ? -1 : 0);
+    const __m128i spriteMask = _mm_set1_epi8(showSprites ? -1 : 0);
+    __m128i hits = zero;
+
+    for (int i = 0; i < 256; i += 16) {
+        __m128i bg = _mm_loadu_si128((const __m128i *)&layers.background[i]);
+        __m128i sprite = _mm_loadu_si128((const __m128i *)&layers.sprite[i]);
+        __m128i flags = _mm_loadu_si128((const __m128i *)&layers.spriteFlags[i]);
+
+        //all ones where transparent or not set
+        __m128i bgClear = _mm_cmpeq_epi8(_mm_and_si128(bg, three), zero);
+        __m128i spriteClear = _mm_cmpeq_epi8(sprite, zero);
+        __m128i front = _mm_cmpeq_epi8(_mm_and_si128(flags, behindBit), zero);
+        __m128i spriteZero = _mm_cmpeq_epi8(_mm_and_si128(flags, zeroBit), zeroBit);
+
+        hits = _mm_or_si128(hits, _mm_andnot_si128(_mm_or_si128(spriteClear, bgClear), spriteZero));
+
+        __m128i showSprite = _mm_andnot_si128(spriteClear, _mm_and_si128(_mm_or_si128(front, bgClear), spriteMask));
+        __m128i pixel = _mm_or_si128(_mm_and_si128(showSprite, sprite),
+                                     _mm_andnot_si128(showSprite, _mm_and_si128(bg, bgMask)));
+        _mm_storeu_si128((__m128i *)&out[i], pixel);
+    }
+
+    return _mm_movemask_epi8(hits) != 0 && showBg && showSprites;
+}
+
+const char *compositorName() {
+    return "sse2";
+}
+
+#elif defined(__ARM_NEON)
+
+bool composeLine(const LineLayers &layers, bool showBg, bool showSprites, u8 *out) {
+    const uint8x16_t three = vdupq_n_u8(3);
+    const uint8x16_t behindBit = vdupq_n_u8(LineLayers::BEHIND_BACKGROUND);
+    const uint8x16_t zeroBit = vdupq_n_u8(LineLayers::SPRITE_ZERO);
+    const uint8x16_t bgMask = vdupq_n_u8(showBg ? 0xFF : 0);
+    const uint8x16_t spriteMask = vdupq_n_u8(showSprites ? 0xFF : 0);
+    uint8x16_t hits = vdupq_n_u8(0);
+
+    for (int i = 0; i < 256; i += 16) {
+        uint8x16_t bg = vld1q_u8(&layers.background[i]);
+        uint8x16_t sprite = vld1q_u8(&layers.sprite[i]);
+        uint8x16_t flags = vld1q_u8(&layers.spriteFlags[i]);
+
+        //all ones where opaque or set
+        uint8x16_t bgOpaque = vtstq_u8(bg, three);
+        uint8x16_t spriteOpaque = vtstq_u8(sprite, sprite);
+        uint8x16_t behind = vtstq_u8(flags, behindBit);
+        uint8x16_t spriteZero = vtstq_u8(flags, zeroBit);
+
+        hits = vorrq_u8(hits, vandq_u8(vandq_u8(spriteOpaque, bgOpaque), spriteZero));
+
+        uint8x16_t showSprite = vandq_u8(vandq_u8(spriteOpaque, spriteMask), vbicq_u8(vdupq_n_u8(0xFF), vandq_u8(behind, bgOpaque)));
+        uint8x16_t pixel = vbslq_u8(showSprite, sprite, vandq_u8(bg, bgMask));
+        vst1q_u8(&out[i], pixel);
+    }
+
+    uint8x8_t folded = vorr_u8(vget_low_u8(hits), vget_high_u8(hits));
+    return vget_lane_u64(vreinterpret_u64_u8(folded), 0) != 0 && showBg && showSprites;
+}
+
+const char *compositorName() {
+    return "neon";
+}
+
+#else
+
+bool composeLine(const LineLayers &layers, bool showBg, bool showSprites, u8 *out) {
+    return composeLineScalar(layers, showBg, showSprites, out);
+}
+
+const char *compositorName() {
+    return "scalar";
+}
+
+#endif
+
+#if defined(__AVX2__)
+
+void expandIndices(const u8 *indices, int count, const u32 *colors, u32 *out) {
+    const __m256i indexMask = _mm256_set1_epi32(63);
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&indices[i]));
+        index = _mm256_and_si256(index, indexMask);
+        _mm256_storeu_si256((__m256i *)&out[i], _mm256_i32gather_epi32((const int *)colors, index, 4));
+    }
+
+    for (; i < count; i++) {
+        out[i] = colors[indices[i] & 63];
+    }
+}
+
+void expandIndices(const u16 *indices, int count, const u32 *colors, u32 *out) {
+    const __m256i indexMask = _mm256_set1_epi32(63);
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i index = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)&indices[i]));
+        index = _mm256_and_si256(index, indexMask);
+        _mm256_storeu_si256((__m256i *)&out[i], _mm256_i32gather_epi32((const int *)colors, index, 4));
+    }
+
+    for (; i < count; i++) {
+        out[i] = colors[indices[i] & 63];
+    }
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+//The colours split into four 64 byte tables, one per byte of a pixel, looked
+//up 16 pixels at a time and interleaved back on the store
+struct ColorPlanes {
+    uint8x16x4_t planes[4];
+
+    ColorPlanes(const u32 *colors) {
+        u8 bytes[4][64];
+
+        for (int i = 0; i < 64; i++) {
+            for (int b = 0; b < 4; b++) {
+                bytes[b][i] = colors[i] >> (b * 8);
+            }
+        }
+
+        for (int b = 0; b < 4; b++) {
+            planes[b] = vld1q_u8_x4(bytes[b]);
+        }
+    }
+
+    void store(uint8x16_t index, u32 *out) const {
+        uint8x16x4_t pixels;
+
+        for (int b = 0; b < 4; b++) {
+            pixels.val[b] = vqtbl4q_u8(planes[b], index);
+        }
+
+        vst4q_u8((u8 *)out, pixels);
+    }
+};
+
+void expandIndices(const u8 *indices, int count, const u32 *colors, u32 *out) {
+    const ColorPlanes planes(colors);
+    const uint8x16_t indexMask = vdupq_n_u8(63);
+    int i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        planes.store(vandq_u8(vld1q_u8(&indices[i]), indexMask), &out[i]);
+    }
+
+    for (; i < count; i++) {
+        out[i] = colors[indices[i] & 63];
+    }
+}
+
+void expandIndices(const u16 *indices, int count, const u32 *colors, u32 *out) {
+    const ColorPlanes planes(colors);
+    const uint8x16_t indexMask = vdupq_n_u8(63);
+    int i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t index = vcombine_u8(vmovn_u16(vld1q_u16(&indices[i])), vmovn_u16(vld1q_u16(&indices[i + 8])));
+        planes.store(vandq_u8(index, indexMask), &out[i]);
+    }
+
+    for (; i < count; i++) {
+        out[i] = colors[indices[i] & 63];
+    }
+}
+
+#else
+
+void expandIndices(const u8 *indices, int count, const u32 *colors, u32 *out) {
+    for (int i = 0; i < count; i++) {
+        out[i] = colors[indices[i] & 63];
+    }
+}
+
+void expandIndices(const u16 *indices, int count, const u32 *colors, u32 *out) {
+    for (int i = 0; i < count; i++) {
+        out[i] = colors[indices[i] & 63];
+    }
+}
+
+#endif
+
+}  //namespace MedNES
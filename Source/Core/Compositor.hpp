@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Common/Typedefs.hpp"
+
+namespace MedNES {
+
+//One scanline split into layers, filled by the PPU before composing
+struct LineLayers {
+    static const u8 BEHIND_BACKGROUND = 1;
+    static const u8 SPRITE_ZERO = 2;
+
+    //attribute bits << 2 | pattern bits, whether or not the background is shown
+    u8 background[256];
+    //0x10 | palette << 2 | pattern bits of the frontmost opaque sprite, 0 if none
+    u8 sprite[256];
+    u8 spriteFlags[256];
+};
+
+//Resolve background/sprite priority into palette RAM indices. Returns true if
+//an opaque sprite zero pixel lands on an opaque background pixel.
+bool composeLine(const LineLayers &, bool showBg, bool showSprites, u8 *out);
+
+//Pixel at a time, what the SIMD paths have to match
+bool composeLineScalar(const LineLayers &, bool showBg, bool showSprites, u8 *out);
+
+//The instruction set composeLine was built for
+const char *compositorName();
+
+//Look up count NES colour indices in 64 colours. Bits above the index, like
+//emphasis in 16-bit indices, are ignored. AVX2 and AArch64 do 8 or 16 at once.
+void expandIndices(const u8 *indices, int count, const u32 *colors, u32 *out);
+void expandIndices(const u16 *indices, int count, const u32 *colors, u32 *out);
+
+};  //namespace MedNES
@@ -29,38 +29,24 @@ void Controller::write(u16 address, u8 data) {
     }
 }
 
-void Controller::setButtonPressed(SDL_Keycode key, bool pressed) {
-    if (key == SDLK_a) {
-        btnState = (pressed) ? (btnState | (1 << 0)) : (btnState & ~(1 << 0));
-    }
-
-    if (key == SDLK_b) {
-        btnState = (pressed) ? (btnState | (1 << 1)) : (btnState & ~(1 << 1));
-    }
-
-    if (key == SDLK_SPACE) {
-        btnState = (pressed) ? (btnState | (1 << 2)) : (btnState & ~(1 << 2));
-    }
-
-    if (key == SDLK_RETURN) {
-        btnState = (pressed) ? (btnState | (1 << 3)) : (btnState & ~(1 << 3));
-    }
-
-    if (key == SDLK_UP) {
-        btnState = (pressed) ? (btnState | (1 << 4)) : (btnState & ~(1 << 4));
-    }
-
-    if (key == SDLK_DOWN) {
-        btnState = (pressed) ? (btnState | (1 << 5)) : (btnState & ~(1 << 5));
-    }
+void Controller::setButtonPressed(Button button, bool pressed) {
+    btnState = (pressed) ? (btnState | (1 << button)) : (btnState & ~(1 << button));
+}
 
-    if (key == SDLK_LEFT) {
-        btnState = (pressed) ? (btnState | (1 << 6)) : (btnState & ~(1 << 6));
-    }
+void Controller::saveState(ControllerState &state) {
+    state.joy1 = JOY1;
+    state.joy2 = JOY2;
+    state.btnStateLocked = btnStateLocked;
+    state.btnState = btnState;
+    state.strobe = strobe;
+}
 
-    if (key == SDLK_RIGHT) {
-        btnState = (pressed) ? (btnState | (1 << 7)) : (btnState & ~(1 << 7));
-    }
+void Controller::loadState(const ControllerState &state) {
+    JOY1 = state.joy1;
+    JOY2 = state.joy2;
+    btnStateLocked = state.btnStateLocked;
+    btnState = state.btnState;
+    strobe = state.strobe;
 }
 
 }  //namespace MedNES
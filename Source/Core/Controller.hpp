@@ -1,6 +1,5 @@
 #pragma once
 
-#include <SDL.h>
 #include <stdio.h>
 
 #include <string>
@@ -10,20 +9,47 @@
 
 namespace MedNES {
 
+struct ControllerState {
+    u8 joy1;
+    u8 joy2;
+    u8 btnStateLocked;
+    u8 btnState;
+    u8 strobe;
+};
+
 class Controller : INESBus {
     u8 JOY1 = 0;
     u8 JOY2 = 0;
     u8 btnStateLocked = 0;
     u8 btnState = 0;
-    bool strobe;
+    bool strobe = false;
 
    public:
+    //In the order the shift register reports them
+    enum Button {
+        A,
+        B,
+        SELECT,
+        START,
+        UP,
+        DOWN,
+        LEFT,
+        RIGHT
+    };
+
     //Bus
     u8 read(u16 address);
     void write(u16 address, u8 data);
 
     //Input
-    void setButtonPressed(SDL_Keycode, bool);
+    void setButtonPressed(Button, bool);
+
+    //All eight buttons at once, bit n is Button n
+    void setButtons(u8 state) { btnState = state; }
+    u8 getButtons() { return btnState; }
+
+    void saveState(ControllerState &);
+    void loadState(const ControllerState &);
 };
 
 };  //namespace MedNES
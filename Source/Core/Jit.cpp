@@ -0,0 +1,409 @@
+#include "Jit.hpp"
+
+#ifdef MEDNES_HAS_JIT
+
+#include <string.h>
+#include <sys/mman.h>
+
+#include "6502.hpp"
+
+namespace MedNES {
+
+template <u8 opcode>
+void Jit::callHandler(CPU6502 *cpu) {
+    (cpu->*CPU6502::opcodeTable[opcode])();
+}
+
+template <size_t... opcodes>
+std::array<NativeBlock, 256> Jit::handlerTable(std::index_sequence<opcodes...>) {
+    return {{&Jit::callHandler<opcodes>...}};
+}
+
+const std::array<NativeBlock, 256> Jit::handlers = Jit::handlerTable(std::make_index_sequence<256>());
+
+void Jit::codeWritten(CPU6502 *cpu, u16 address) {
+    cpu->codeWritten(address);
+}
+
+static int32_t offsetIn(CPU6502 *cpu, const void *member) {
+    return (int32_t)((const u8 *)member - (const u8 *)cpu);
+}
+
+Jit::Jit(CPU6502 *cpu) : cpu(cpu) {
+    accumulatorOffset = offsetIn(cpu, &cpu->accumulator);
+    xRegisterOffset = offsetIn(cpu, &cpu->xRegister);
+    yRegisterOffset = offsetIn(cpu, &cpu->yRegister);
+    stackPointerOffset = offsetIn(cpu, &cpu->stackPointer);
+    statusRegisterOffset = offsetIn(cpu, &cpu->statusRegister);
+    programCounterOffset = offsetIn(cpu, &cpu->programCounter);
+    clockOffset = offsetIn(cpu, &cpu->scheduler.clock);
+    deadlineOffset = offsetIn(cpu, &cpu->scheduler.next);
+    blockAbortedOffset = offsetIn(cpu, &cpu->blockAborted);
+    codeWatchOffset = offsetIn(cpu, &cpu->codeWatch[0]);
+    instructionsOffset = offsetIn(cpu, &cpu->instructions);
+    ram = cpu->ram.data();
+}
+
+Jit::~Jit() {
+    disable();
+}
+
+bool Jit::enable() {
+    if (code != nullptr) {
+        return true;
+    }
+
+    void *memory = mmap(nullptr, CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+
+    code = (u8 *)memory;
+    used = 0;
+    return true;
+}
+
+void Jit::disable() {
+    if (code != nullptr) {
+        munmap(code, CODE_SIZE);
+        code = nullptr;
+    }
+}
+
+void Jit::flush() {
+    used = 0;
+}
+
+NativeBlock Jit::compile(const Block &block) {
+    if (code == nullptr || used + MAX_BLOCK_CODE > CODE_SIZE) {
+        return nullptr;
+    }
+
+    out.clear();
+    exits.clear();
+
+    //push rbx; mov rbx, rdi
+    emit({0x53, 0x48, 0x89, 0xFB});
+
+    int offset = block.code - block.page;
+
+    for (int i = 0; i < block.count; i++) {
+        u8 opcode = block.page[offset];
+        int length = CPU6502::opcodeLengths[opcode];
+        bool inlined = false;
+
+        //the last instruction may have its operand on the next page
+        if (length != 0 && offset + length <= 256) {
+            inlined = emitInline(opcode, block.page + offset + 1);
+        }
+
+        if (inlined) {
+            inlinedOps++;
+        } else {
+            emitCall(opcode);
+            calledOps++;
+        }
+
+        emitCountInstruction();
+
+        if (i != block.count - 1) {
+            emitExitChecks(!inlined || opcode == 0x84 || opcode == 0x85 || opcode == 0x86);
+        }
+
+        offset += length;
+    }
+
+    size_t epilogue = out.size();
+
+    //pop rbx; ret
+    emit({0x5B, 0xC3});
+
+    for (size_t exit : exits) {
+        u32 rel = (u32)(epilogue - (exit + 4));
+        memcpy(&out[exit], &rel, 4);
+    }
+
+    u8 *native = code + used;
+    memcpy(native, out.data(), out.size());
+    used += (out.size() + 15) & ~(size_t)15;
+    compiledBlocks++;
+
+    return (NativeBlock)native;
+}
+
+bool Jit::emitInline(u8 opcode, const u8 *operand) {
+    switch (opcode) {
+        //CLC, SEC, CLI, SEI, CLV, CLD, SED
+        case 0x18:
+        case 0x38:
+        case 0x58:
+        case 0x78:
+        case 0xB8:
+        case 0xD8:
+        case 0xF8: {
+            static const u8 masks[8] = {0x01, 0x01, 0x04, 0x04, 0x40, 0x40, 0x08, 0x08};
+            emitFlag(masks[opcode >> 5], (opcode & 0x20) && opcode != 0xB8);
+            emitTick(2);
+            emitAdvancePC(1);
+            return true;
+        }
+        //TAX, TAY, TXA, TYA, TSX, TXS
+        case 0xAA:
+        case 0xA8:
+        case 0x8A:
+        case 0x98:
+        case 0xBA:
+        case 0x9A: {
+            int32_t from = opcode == 0xAA || opcode == 0xA8 ? accumulatorOffset : opcode == 0x8A || opcode == 0x9A ? xRegisterOffset : opcode == 0x98 ? yRegisterOffset : stackPointerOffset;
+            int32_t to = opcode == 0xAA || opcode == 0xBA ? xRegisterOffset : opcode == 0xA8 ? yRegisterOffset : opcode == 0x9A ? stackPointerOffset : accumulatorOffset;
+            emitLoad(from);
+            emitStore(to);
+
+            if (opcode != 0x9A) {
+                emitSetNZ();
+            }
+
+            emitTick(2);
+            emitAdvancePC(1);
+            return true;
+        }
+        //INX, INY, DEX, DEY
+        case 0xE8:
+        case 0xC8:
+        case 0xCA:
+        case 0x88: {
+            int32_t reg = opcode == 0xE8 || opcode == 0xCA ? xRegisterOffset : yRegisterOffset;
+            emitLoad(reg);
+            //inc al / dec al
+            emit({0xFE, (u8)(opcode == 0xE8 || opcode == 0xC8 ? 0xC0 : 0xC8)});
+            emitStore(reg);
+            emitSetNZ();
+            emitTick(2);
+            emitAdvancePC(1);
+            return true;
+        }
+        case 0xEA:
+            emitTick(2);
+            emitAdvancePC(1);
+            return true;
+        //LDA, LDX, LDY immediate
+        case 0xA9:
+        case 0xA2:
+        case 0xA0: {
+            int32_t reg = opcode == 0xA9 ? accumulatorOffset : opcode == 0xA2 ? xRegisterOffset : yRegisterOffset;
+            //mov byte [rbx + reg], imm8
+            emit({0xC6});
+            emitDisp(0x83, reg);
+            emit({*operand});
+            emitSetNZ(*operand);
+            emitTick(2);
+            emitAdvancePC(2);
+            return true;
+        }
+        //AND, ORA, EOR immediate
+        case 0x29:
+        case 0x09:
+        case 0x49:
+            emitLoad(accumulatorOffset);
+            emit({(u8)(opcode == 0x29 ? 0x24 : opcode == 0x09 ? 0x0C : 0x34), *operand});
+            emitStore(accumulatorOffset);
+            emitSetNZ();
+            emitTick(2);
+            emitAdvancePC(2);
+            return true;
+        //CMP, CPX, CPY immediate
+        case 0xC9:
+        case 0xE0:
+        case 0xC0:
+            emitLoad(opcode == 0xC9 ? accumulatorOffset : opcode == 0xE0 ? xRegisterOffset : yRegisterOffset);
+            emitCompare(*operand);
+            emitTick(2);
+            emitAdvancePC(2);
+            return true;
+        //LDA, LDX, LDY zero page
+        case 0xA5:
+        case 0xA6:
+        case 0xA4:
+            emitZeroPageLoad(*operand);
+            emitStore(opcode == 0xA5 ? accumulatorOffset : opcode == 0xA6 ? xRegisterOffset : yRegisterOffset);
+            emitSetNZ();
+            emitTick(3);
+            emitAdvancePC(2);
+            return true;
+        //STA, STX, STY zero page
+        case 0x85:
+        case 0x86:
+        case 0x84:
+            emitLoad(opcode == 0x85 ? accumulatorOffset : opcode == 0x86 ? xRegisterOffset : yRegisterOffset);
+            emitTick(3);
+            emitZeroPageStore(*operand);
+            emitAdvancePC(2);
+            return true;
+    }
+
+    return false;
+}
+
+//Opcode fetch tick, the interpreter's handler, PC past the opcode
+void Jit::emitCall(u8 opcode) {
+    emitTick(1);
+    //mov rdi, rbx; mov rax, handler; call rax
+    emit({0x48, 0x89, 0xDF, 0x48, 0xB8});
+    emit64((u64)handlers[opcode]);
+    emit({0xFF, 0xD0});
+    emitAdvancePC(1);
+}
+
+//Leave when an event is due or a write ended the block, as the interpreter does
+void Jit::emitExitChecks(bool aborted) {
+    //mov rax, [rbx + clock]; cmp rax, [rbx + next]; jae exit
+    emit({0x48, 0x8B});
+    emitDisp(0x83, clockOffset);
+    emit({0x48, 0x3B});
+    emitDisp(0x83, deadlineOffset);
+    emit({0x0F, 0x83});
+    exits.push_back(out.size());
+    emit32(0);
+
+    if (aborted) {
+        //cmp byte [rbx + blockAborted], 0; jne exit
+        emit({0x80});
+        emitDisp(0xBB, blockAbortedOffset);
+        emit({0x00, 0x0F, 0x85});
+        exits.push_back(out.size());
+        emit32(0);
+    }
+}
+
+void Jit::emitTick(int cycles) {
+    //add qword [rbx + clock], imm8
+    emit({0x48, 0x83});
+    emitDisp(0x83, clockOffset);
+    emit({(u8)(cycles * CPU_CLOCK_DIVIDER)});
+}
+
+void Jit::emitCountInstruction() {
+    //add qword [rbx + instructions], 1
+    emit({0x48, 0x83});
+    emitDisp(0x83, instructionsOffset);
+    emit({0x01});
+}
+
+void Jit::emitAdvancePC(int bytes) {
+    //add word [rbx + programCounter], imm8
+    emit({0x66, 0x83});
+    emitDisp(0x83, programCounterOffset);
+    emit({(u8)bytes});
+}
+
+void Jit::emitLoad(int32_t offset) {
+    //movzx eax, byte [rbx + offset]
+    emit({0x0F, 0xB6});
+    emitDisp(0x83, offset);
+}
+
+void Jit::emitStore(int32_t offset) {
+    //mov byte [rbx + offset], al
+    emit({0x88});
+    emitDisp(0x83, offset);
+}
+
+//N and Z from al
+void Jit::emitSetNZ() {
+    //movzx ecx, byte [rbx + statusRegister]; and ecx, 0x7D
+    emit({0x0F, 0xB6});
+    emitDisp(0x8B, statusRegisterOffset);
+    emit({0x83, 0xE1, 0x7D});
+    //test al, al; jnz +3; or ecx, 2
+    emit({0x84, 0xC0, 0x75, 0x03, 0x83, 0xC9, 0x02});
+    //mov edx, eax; and edx, 0x80; or ecx, edx
+    emit({0x89, 0xC2, 0x81, 0xE2, 0x80, 0x00, 0x00, 0x00, 0x09, 0xD1});
+    //mov byte [rbx + statusRegister], cl
+    emit({0x88});
+    emitDisp(0x8B, statusRegisterOffset);
+}
+
+void Jit::emitSetNZ(u8 value) {
+    u8 flags = (value & 0x80) | (value == 0 ? 0x02 : 0x00);
+    emitFlag(0x82, false);
+
+    if (flags != 0) {
+        emitFlag(flags, true);
+    }
+}
+
+//N, Z and C of al compared with value
+void Jit::emitCompare(u8 value) {
+    //movzx ecx, byte [rbx + statusRegister]; and ecx, 0x7C
+    emit({0x0F, 0xB6});
+    emitDisp(0x8B, statusRegisterOffset);
+    emit({0x83, 0xE1, 0x7C});
+    //cmp al, value; jne +3; or ecx, 2
+    emit({0x3C, value, 0x75, 0x03, 0x83, 0xC9, 0x02});
+    //cmp al, value; jb +3; or ecx, 1
+    emit({0x3C, value, 0x72, 0x03, 0x83, 0xC9, 0x01});
+    //sub al, value; and eax, 0x80; or ecx, eax
+    emit({0x2C, value, 0x25, 0x80, 0x00, 0x00, 0x00, 0x09, 0xC1});
+    //mov byte [rbx + statusRegister], cl
+    emit({0x88});
+    emitDisp(0x8B, statusRegisterOffset);
+}
+
+void Jit::emitFlag(u8 mask, bool set) {
+    //or / and byte [rbx + statusRegister], imm8
+    emit({0x80});
+    emitDisp(set ? 0x8B : 0xA3, statusRegisterOffset);
+    emit({(u8)(set ? mask : ~mask)});
+}
+
+//Zero page is always internal RAM
+void Jit::emitZeroPageLoad(u8 address) {
+    //mov rcx, ram + address; movzx eax, byte [rcx]
+    emit({0x48, 0xB9});
+    emit64((u64)(ram + address));
+    emit({0x0F, 0xB6, 0x01});
+}
+
+void Jit::emitZeroPageStore(u8 address) {
+    //mov rcx, ram + address; mov byte [rcx], al
+    emit({0x48, 0xB9});
+    emit64((u64)(ram + address));
+    emit({0x88, 0x01});
+    //cmp byte [rbx + codeWatch], 0; je +20
+    emit({0x80});
+    emitDisp(0xBB, codeWatchOffset);
+    emit({0x00, 0x74, 0x14});
+    //mov rdi, rbx; mov esi, address; mov rax, codeWritten; call rax
+    emit({0x48, 0x89, 0xDF, 0xBE});
+    emit32(address);
+    emit({0x48, 0xB8});
+    emit64((u64)&Jit::codeWritten);
+    emit({0xFF, 0xD0});
+}
+
+void Jit::emit(std::initializer_list<u8> bytes) {
+    out.insert(out.end(), bytes);
+}
+
+void Jit::emit32(u32 value) {
+    u8 bytes[4];
+    memcpy(bytes, &value, 4);
+    out.insert(out.end(), bytes, bytes + 4);
+}
+
+void Jit::emit64(u64 value) {
+    u8 bytes[8];
+    memcpy(bytes, &value, 8);
+    out.insert(out.end(), bytes, bytes + 8);
+}
+
+//ModRM for [rbx + disp32] followed by the displacement
+void Jit::emitDisp(u8 modrm, int32_t offset) {
+    out.push_back(modrm);
+    emit32((u32)offset);
+}
+
+}  //namespace MedNES
+
+#endif
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <array>
+#include <utility>
+#include <vector>
+
+#include "BlockCache.hpp"
+#include "Common/Typedefs.hpp"
+
+//Build with -DMEDNES_JIT to get the x86-64 block translator
+#if defined(MEDNES_JIT) && defined(__x86_64__) && !defined(_WIN32)
+#define MEDNES_HAS_JIT
+#endif
+
+namespace MedNES {
+
+#ifdef MEDNES_HAS_JIT
+
+//Translates hot blocks from read-only pages into x86-64. Register, flag,
+//immediate and zero page instructions are emitted inline, everything else
+//calls the interpreter's handler so bus accesses, I/O and page crossing
+//cycles behave exactly as they do there.
+class Jit {
+   public:
+    Jit(CPU6502 *cpu);
+    Jit(const Jit &) = delete;
+    Jit &operator=(const Jit &) = delete;
+    ~Jit();
+
+    bool enable();
+    void disable();
+    bool isEnabled() { return code != nullptr; }
+
+    //nullptr once the code buffer is full, flush() and retry
+    NativeBlock compile(const Block &block);
+    void flush();
+
+    //runs of a block before it is translated
+    int hotThreshold = 16;
+
+    u64 compiledBlocks = 0;
+    u64 inlinedOps = 0;
+    u64 calledOps = 0;
+
+   private:
+    static const size_t CODE_SIZE = 4 << 20;
+    static const size_t MAX_BLOCK_CODE = 2048;
+
+    CPU6502 *cpu;
+    u8 *code = nullptr;
+    size_t used = 0;
+
+    //CPU6502 member displacements from the cpu pointer held in rbx
+    int32_t accumulatorOffset;
+    int32_t xRegisterOffset;
+    int32_t yRegisterOffset;
+    int32_t stackPointerOffset;
+    int32_t statusRegisterOffset;
+    int32_t programCounterOffset;
+    int32_t clockOffset;
+    int32_t deadlineOffset;
+    int32_t blockAbortedOffset;
+    int32_t codeWatchOffset;
+    int32_t instructionsOffset;
+    u8 *ram;
+
+    std::vector<u8> out;
+    std::vector<size_t> exits;
+
+    bool emitInline(u8 opcode, const u8 *operand);
+    void emitCall(u8 opcode);
+    void emitExitChecks(bool aborted);
+
+    void emitTick(int cycles);
+    void emitCountInstruction();
+    void emitAdvancePC(int bytes);
+    void emitLoad(int32_t offset);
+    void emitStore(int32_t offset);
+    void emitSetNZ();
+    void emitSetNZ(u8 value);
+    void emitCompare(u8 value);
+    void emitFlag(u8 mask, bool set);
+    void emitZeroPageLoad(u8 address);
+    void emitZeroPageStore(u8 address);
+
+    void emit(std::initializer_list<u8>);
+    void emit32(u32);
+    void emit64(u64);
+    void emitDisp(u8 modrm, int32_t offset);
+
+    //C entry points the generated code calls into
+    template <u8 opcode>
+    static void callHandler(CPU6502 *);
+
+    template <size_t... opcodes>
+    static std::array<NativeBlock, 256> handlerTable(std::index_sequence<opcodes...>);
+
+    static const std::array<NativeBlock, 256> handlers;
+
+    static void codeWritten(CPU6502 *, u16);
+};
+
+#endif
+
+};  //namespace MedNES
@@ -3,29 +3,31 @@
 
 namespace MedNES {
 
-u8 CNROM::read(u16 address) {
-    if (address < 0x8000) {
-        return 0;
-    }
-
-    address = (address - 0x8000) % prgCode.size();
-    return prgCode[address];
-}
-
 void CNROM::write(u16 address, u8 data) {
     if (address < 0x8000) {
         return;
     }
 
     bankSelect = data & 3;
+    mapChr();
+}
+
+void CNROM::mapPrg() {
+    //16kb images are mirrored into $C000
+    mapPrgRom(0x8000, 0x4000, 0);
+    mapPrgRom(0xC000, 0x4000, prgSize > 0x4000 ? 0x4000 : 0);
+}
+
+void CNROM::mapChr() {
+    mapChrBank(0x0000, 0x2000, bankSelect * 8192);
 }
 
-u8 CNROM::ppuread(u16 address) {
-    u16 ppuaddr = bankSelect * 8192 + address;
-    return chrROM[ppuaddr];
+void CNROM::saveRegisters(MapperState &state) {
+    state.registers[0] = bankSelect;
 }
 
-void CNROM::ppuwrite(u16 address, u8 data) {
+void CNROM::loadRegisters(const MapperState &state) {
+    bankSelect = state.registers[0];
 }
 
 }  //namespace MedNES
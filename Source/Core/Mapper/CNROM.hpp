@@ -4,14 +4,21 @@
 
 namespace MedNES {
 
-class CNROM : public Mapper {
+class CNROM final : public Mapper {
    public:
-    CNROM(std::vector<u8> &prgCode, std::vector<u8> &chrROM, int mirroring) : Mapper(prgCode, chrROM, mirroring) {}
+    CNROM(const Cartridge &cartridge) : Mapper(cartridge) {
+        mapPrg();
+        mapChr();
+    }
+
     ~CNROM() override = default;
-    u8 read(u16 address) override;
     void write(u16 address, u8 data) override;
-    u8 ppuread(u16 address) override;
-    void ppuwrite(u16 address, u8 data) override;
+
+   protected:
+    void mapPrg() override;
+    void mapChr() override;
+    void saveRegisters(MapperState &) override;
+    void loadRegisters(const MapperState &) override;
 
    private:
     u8 bankSelect = 0;
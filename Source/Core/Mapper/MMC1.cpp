@@ -1,5 +1,7 @@
 #include "MMC1.hpp"
 
+#include <string.h>
+
 namespace MedNES {
 
 void MMC1::write(u16 address, u8 data) {
@@ -15,6 +17,7 @@ void MMC1::write(u16 address, u8 data) {
     if (data & 0x80) {
         controlReg.val |= 0xC;
         mmc1SR = 0x10;
+        mapPrg();
         return;
     }
 
@@ -28,13 +31,13 @@ void MMC1::write(u16 address, u8 data) {
 
                 //Make mirroring compatible with ines mirroring
                 if (controlReg.mirroring == 0) {
-                    mirroring = 2;
+                    setMirroring(2);
                 } else if (controlReg.mirroring == 1) {
-                    mirroring = 3;
+                    setMirroring(3);
                 } else if (controlReg.mirroring == 2) {
-                    mirroring = 1;
+                    setMirroring(1);
                 } else {
-                    mirroring = 0;
+                    setMirroring(0);
                 }
 
                 break;
@@ -53,69 +56,63 @@ void MMC1::write(u16 address, u8 data) {
         }
 
         mmc1SR = 0x10;
+        mapPrg();
+        mapChr();
     } else {
         mmc1SR = (mmc1SR >> 1) | ((data & 1) << 4);
     }
 }
 
-u8 MMC1::read(u16 address) {
+void MMC1::mapPrg() {
     //prg ram region
-
-    if (address < 0x8000) {
-        if (!(prgBank & 0x10)) {
-            return prgRam[address - 0x6000];
-        }
-
-        return 0;
-    }
+    mapPrgRam(!(prgBank & 0x10) ? prgRam : nullptr);
 
     //switch 32kb banks
     if (controlReg.prgRomBankMode <= 1) {
         //ignore low bit of bankselect
         u8 bankSelect = prgBank & 0xE;
-        u32 address_32 = (address - 0x8000) + (bankSelect * 0x8000);
-
-        return prgCode[address_32];
+        mapPrgRom(0x8000, 0x8000, bankSelect * 0x8000);
         //fixed first 0x8000, switch (16kb) upper
     } else if (controlReg.prgRomBankMode == 2) {
-        if (address < 0xC000) {
-            return prgCode[address - 0x8000];
-        } else {
-            u8 bankSelect = prgBank & 0xF;
-            u32 address_32 = (address - 0xC000) + (bankSelect * 0x4000);
-
-            return prgCode[address_32];
-        }
+        u8 bankSelect = prgBank & 0xF;
+        mapPrgRom(0x8000, 0x4000, 0);
+        mapPrgRom(0xC000, 0x4000, bankSelect * 0x4000);
         //Switch (16kb) 0x8000, fixed upper
     } else {
-        if (address < 0xC000) {
-            u8 bankSelect = prgBank & 0xF;
-            u32 address_32 = (bankSelect * 0x4000) + (address - 0x8000);
-
-            return prgCode[address_32];
-        } else {
-            return prgCode[prgCode.size() - 0x4000 + (address - 0xC000)];
-        }
+        u8 bankSelect = prgBank & 0xF;
+        mapPrgRom(0x8000, 0x4000, bankSelect * 0x4000);
+        mapPrgRom(0xC000, 0x4000, prgSize - 0x4000);
     }
 }
 
-void MMC1::ppuwrite(u16 address, u8 data) {
-    chrROM[address] = data;
-}
-
-u8 MMC1::ppuread(u16 address) {
+void MMC1::mapChr() {
     //8kb mode
     if (controlReg.chrRomBankMode == 0) {
         //bit0 ignored
-        return chrROM[(chrBank0 & 0x1E) * 0x2000 + address];
+        mapChrBank(0x0000, 0x2000, (chrBank0 & 0x1E) * 0x2000);
         //4kb mode
     } else {
-        if (address < 0x1000) {
-            return chrROM[chrBank0 * 0x1000 + address];
-        } else {
-            return chrROM[chrBank1 * 0x1000 + (address - 0x1000)];
-        }
+        mapChrBank(0x0000, 0x1000, chrBank0 * 0x1000);
+        mapChrBank(0x1000, 0x1000, chrBank1 * 0x1000);
     }
 }
 
+void MMC1::saveRegisters(MapperState &state) {
+    state.registers[0] = mmc1SR;
+    state.registers[1] = controlReg.val;
+    state.registers[2] = chrBank0;
+    state.registers[3] = chrBank1;
+    state.registers[4] = prgBank;
+    memcpy(state.prgRam, prgRam, sizeof(prgRam));
+}
+
+void MMC1::loadRegisters(const MapperState &state) {
+    mmc1SR = state.registers[0];
+    controlReg.val = state.registers[1];
+    chrBank0 = state.registers[2];
+    chrBank1 = state.registers[3];
+    prgBank = state.registers[4];
+    memcpy(prgRam, state.prgRam, sizeof(prgRam));
+}
+
 }  //namespace MedNES
@@ -4,17 +4,22 @@
 
 namespace MedNES {
 
-class MMC1 : public Mapper {
+class MMC1 final : public Mapper {
    public:
-    MMC1(std::vector<u8> &prgCode, std::vector<u8> &chrROM, int mirroring) : Mapper(prgCode, chrROM, mirroring) {
+    MMC1(const Cartridge &cartridge) : Mapper(cartridge) {
         controlReg.val = 0xF;
+        mapPrg();
+        mapChr();
     }
 
     ~MMC1() override = default;
     void write(u16 address, u8 data) override;
-    u8 read(u16 address) override;
-    void ppuwrite(u16 address, u8 data) override;
-    u8 ppuread(u16 address) override;
+
+   protected:
+    void mapPrg() override;
+    void mapChr() override;
+    void saveRegisters(MapperState &) override;
+    void loadRegisters(const MapperState &) override;
 
    private:
     //written by CPU
@@ -34,9 +39,9 @@ class MMC1 : public Mapper {
         u8 val;
     } controlReg;
 
-    u8 chrBank0;
-    u8 chrBank1;
-    u8 prgBank;
+    u8 chrBank0 = 0;
+    u8 chrBank1 = 0;
+    u8 prgBank = 0;
 };
 
 };  //namespace MedNES
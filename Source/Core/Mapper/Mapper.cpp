@@ -1,13 +1,121 @@
 #include "Mapper.hpp"
 
+#include <string.h>
+
 namespace MedNES {
 
-u8 Mapper::ppuread(u16 address) {
-    return chrROM[address];
+Mapper::Mapper(const Cartridge &cartridge) : image(cartridge.image),
+                                             prgCode(cartridge.prg),
+                                             prgSize(cartridge.prgSize),
+                                             chr(cartridge.chr),
+                                             chrSize(cartridge.chrSize),
+                                             romCrc32(cartridge.crc32),
+                                             mirroring(cartridge.mirroring),
+                                             chrWritable(cartridge.chr == nullptr) {
+    if (chrWritable) {
+        chrRam.resize(0x2000);
+        chr = chrRam.data();
+        chrSize = chrRam.size();
+    }
 }
 
 void Mapper::ppuwrite(u16 address, u8 data) {
-    chrROM[address] = data;
+    if (!chrWritable) {
+        return;
+    }
+
+    u32 offset = &chrPages[(address >> 10) & 7][address & 0x3FF] - chr;
+    chrRam[offset] = data;
+
+    if (tileCache != nullptr) {
+        tileCache->write(offset, chr);
+    }
+}
+
+void Mapper::saveState(MapperState &state) {
+    state.romCrc32 = romCrc32;
+    state.prgSize = prgSize;
+    state.chrSize = chrSize;
+    state.mirroring = mirroring;
+    memset(state.registers, 0, sizeof(state.registers));
+    memset(state.prgRam, 0, sizeof(state.prgRam));
+
+    if (chrSize == sizeof(state.chr)) {
+        memcpy(state.chr, chr, sizeof(state.chr));
+    } else {
+        memset(state.chr, 0, sizeof(state.chr));
+    }
+
+    saveRegisters(state);
+}
+
+bool Mapper::loadState(const MapperState &state) {
+    if (state.romCrc32 != romCrc32 || state.prgSize != prgSize || state.chrSize != chrSize) {
+        return false;
+    }
+
+    setMirroring(state.mirroring);
+
+    //only redecode tiles when CHR RAM changed, CHR ROM can't
+    if (chrWritable && memcmp(chrRam.data(), state.chr, sizeof(state.chr)) != 0) {
+        memcpy(chrRam.data(), state.chr, sizeof(state.chr));
+
+        if (tileCache != nullptr) {
+            tileCache->load(chr, chrSize);
+        }
+    }
+
+    loadRegisters(state);
+    mapPrg();
+    mapChr();
+
+    return true;
+}
+
+//Banks past the end of ROM wrap around
+void Mapper::mapPrgRom(u16 address, u32 size, u32 prgOffset) {
+    for (u32 i = 0; i < size / 0x2000; i++) {
+        const u8 *page = &prgCode[(prgOffset + i * 0x2000) % prgSize];
+        prgPages[((address - 0x8000) >> 13) + i] = page;
+
+        //ROM is read only, writes go to the mapper registers
+        if (pageTable != nullptr) {
+            pageTable->map(address + i * 0x2000, 0x2000, page, nullptr);
+        }
+    }
+}
+
+//8kb of RAM at $6000, null leaves it unmapped
+void Mapper::mapPrgRam(u8 *ram) {
+    prgRamPage = ram;
+
+    if (pageTable == nullptr) {
+        return;
+    }
+
+    if (ram != nullptr) {
+        pageTable->map(0x6000, 0x2000, ram, ram);
+    } else {
+        pageTable->unmap(0x6000, 0x2000);
+    }
+}
+
+void Mapper::mapChrBank(u16 address, u32 size, u32 chrOffset) {
+    for (u32 i = 0; i < size / 0x400; i++) {
+        chrPages[(address >> 10) + i] = &chr[(chrOffset + i * 0x400) % chrSize];
+    }
+
+    if (tileCache != nullptr) {
+        tileCache->map(address, size, chrOffset);
+    }
+}
+
+void Mapper::setMirroring(int mirroring) {
+    this->mirroring = mirroring;
+
+    if (nametables != nullptr) {
+        nametables->mirror(mirroring);
+    }
 }
 
 }  //namespace MedNES
@@ -3,27 +3,116 @@
 
 #include <vector>
 
+#include "../Common/NametableMap.hpp"
+#include "../Common/PageTable.hpp"
+#include "../Common/TileCache.hpp"
 #include "../Common/Typedefs.hpp"
+#include "../RomImage.hpp"
 
 namespace MedNES {
 
+//Bank registers and cartridge RAM, boards leave what they don't have zeroed
+struct MapperState {
+    //the cartridge the state belongs to
+    u32 romCrc32;
+    u32 prgSize;
+    u32 chrSize;
+    s32 mirroring;
+    u8 registers[8];
+    u8 prgRam[0x2000];
+    //boards with a single 8kb CHR bank, which is RAM on most of them
+    u8 chr[0x2000];
+};
+
 class Mapper {
    public:
-    Mapper(std::vector<u8> &prgCode, std::vector<u8> &chrROM, int mirroring) : prgCode(prgCode),
-                                                                               chrROM(chrROM),
-                                                                               mirroring(mirroring) {}
+    //ROM stays in the cartridge image, only CHR RAM is allocated here
+    Mapper(const Cartridge &cartridge);
 
     virtual ~Mapper() {}
-    virtual u8 read(u16 address) = 0;
+
+    //CPU and PPU accesses go through the bank pages, which boards update on
+    //register writes. Board code only runs for register writes.
+    u8 read(u16 address) {
+        if (address >= 0x8000) {
+            return prgPages[(address >> 13) & 3][address & 0x1FFF];
+        }
+
+        if (address >= 0x6000 && prgRamPage != nullptr) {
+            return prgRamPage[address & 0x1FFF];
+        }
+
+        return 0;
+    }
+
     virtual void write(u16 address, u8 data) = 0;
-    virtual u8 ppuread(u16 address);
-    virtual void ppuwrite(u16 address, u8 data);
+    u8 ppuread(u16 address) { return chrPages[(address >> 10) & 7][address & 0x3FF]; }
+    void ppuwrite(u16 address, u8 data);
     int getMirroring() { return mirroring; }
 
+    void saveState(MapperState &);
+    //False for a state saved from a different cartridge
+    bool loadState(const MapperState &);
+
+    //The CPU hands over its page table, the mapper keeps it in sync with its banks.
+    void setPageTable(PageTable *pageTable) {
+        this->pageTable = pageTable;
+        mapPrg();
+    }
+
+    //The PPU hands over its tile cache, the mapper keeps it in sync with CHR.
+    void setTileCache(TileCache *tileCache) {
+        this->tileCache = tileCache;
+        tileCache->load(chr, chrSize);
+        mapChr();
+    }
+
+    //The PPU hands over its nametable map, the mapper keeps it in sync with
+    //its mirroring.
+    void setNametables(NametableMap *nametables) {
+        this->nametables = nametables;
+        nametables->mirror(mirroring);
+    }
+
    protected:
-    std::vector<u8> prgCode;
-    std::vector<u8> chrROM;
+    //held so PRG and CHR ROM stay mapped
+    std::shared_ptr<const RomImage> image;
+    const u8 *prgCode;
+    u32 prgSize;
+    //CHR ROM in the image, or chrRam
+    const u8 *chr;
+    u32 chrSize;
+    std::vector<u8> chrRam;
+    u32 romCrc32;
     int mirroring;
+    PageTable *pageTable = nullptr;
+    TileCache *tileCache = nullptr;
+    NametableMap *nametables = nullptr;
+
+    //8kb PRG ROM pages at $8000-$FFFF, PRG RAM at $6000 or null, 1kb CHR pages
+    const u8 *prgPages[4] = {nullptr};
+    u8 *prgRamPage = nullptr;
+    const u8 *chrPages[8] = {nullptr};
+    //pattern writes only reach CHR RAM
+    bool chrWritable;
+
+    //Publish the current PRG banks to the pages and the page table. Boards call
+    //it from their constructor and on bank switches.
+    virtual void mapPrg() = 0;
+    void mapPrgRom(u16 address, u32 size, u32 prgOffset);
+    void mapPrgRam(u8 *ram);
+
+    //Publish the current CHR banks to the pages and the tile cache, boards
+    //without CHR banking see the first 8kb
+    virtual void mapChr() { mapChrBank(0x0000, 0x2000, 0); }
+    void mapChrBank(u16 address, u32 size, u32 chrOffset);
+
+    //Switch mirroring and relayout the nametables
+    void setMirroring(int mirroring);
+
+    //Board specific registers and RAM
+    virtual void saveRegisters(MapperState &) {}
+    virtual void loadRegisters(const MapperState &) {}
 };
 
 };  //namespace MedNES
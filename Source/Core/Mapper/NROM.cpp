@@ -2,17 +2,14 @@
 
 namespace MedNES {
 
-u8 NROM::read(u16 address) {
-    if (address < 0x8000) {
-        return 0;
-    }
-
-    address = (address - 0x8000) % prgCode.size();
-    return prgCode[address];
-}
-
 void NROM::write(u16 address, u8 data) {
     //No write in NROM
 }
 
+void NROM::mapPrg() {
+    //16kb images are mirrored into $C000
+    mapPrgRom(0x8000, 0x4000, 0);
+    mapPrgRom(0xC000, 0x4000, prgSize > 0x4000 ? 0x4000 : 0);
+}
+
 }  //namespace MedNES
@@ -4,12 +4,18 @@
 
 namespace MedNES {
 
-class NROM : public Mapper {
+class NROM final : public Mapper {
    public:
-    NROM(std::vector<u8> &prgCode, std::vector<u8> &chrROM, int mirroring) : Mapper(prgCode, chrROM, mirroring) {}
+    NROM(const Cartridge &cartridge) : Mapper(cartridge) {
+        mapPrg();
+        mapChr();
+    }
+
     ~NROM() override = default;
-    u8 read(u16 address) override;
     void write(u16 address, u8 data) override;
+
+   protected:
+    void mapPrg() override;
 };
 
 };  //namespace MedNES
@@ -2,28 +2,26 @@
 
 namespace MedNES {
 
-u8 UnROM::read(u16 address) {
+void UnROM::write(u16 address, u8 data) {
     if (address < 0x8000) {
-        return 0;
+        return;
     }
 
-    u32 address_32 = 0;
-
-    if (address >= 0xC000) {
-        address_32 = lastBankStart + (address - 0xC000);
-    } else {
-        address_32 = (address - 0x8000) + bankSelect * 16384;
-    }
+    bankSelect = data & 7;
+    mapPrg();
+}
 
-    return prgCode[address_32];
+void UnROM::mapPrg() {
+    mapPrgRom(0x8000, 0x4000, bankSelect * 16384);
+    mapPrgRom(0xC000, 0x4000, lastBankStart);
 }
 
-void UnROM::write(u16 address, u8 data) {
-    if (address < 0x8000) {
-        return;
-    }
+void UnROM::saveRegisters(MapperState &state) {
+    state.registers[0] = bankSelect;
+}
 
-    bankSelect = data & 7;
+void UnROM::loadRegisters(const MapperState &state) {
+    bankSelect = state.registers[0];
 }
 
 }  //namespace MedNES
@@ -4,15 +4,22 @@
 
 namespace MedNES {
 
-class UnROM : public Mapper {
+class UnROM final : public Mapper {
    public:
-    UnROM(std::vector<u8> &prgCode, std::vector<u8> &chrROM, int mirroring) : Mapper(prgCode, chrROM, mirroring) {
-        lastBankStart = prgCode.size() - 16384;
+    UnROM(const Cartridge &cartridge) : Mapper(cartridge) {
+        lastBankStart = prgSize - 16384;
+        mapPrg();
+        mapChr();
     }
+
     ~UnROM() override = default;
-    u8 read(u16 address) override;
     void write(u16 address, u8 data) override;
 
+   protected:
+    void mapPrg() override;
+    void saveRegisters(MapperState &) override;
+    void loadRegisters(const MapperState &) override;
+
    private:
     u8 bankSelect = 0;
     u32 lastBankStart = 0;
@@ -1,7 +1,12 @@
 #include "PPU.hpp"
 
+#include <string.h>
+
+#include <algorithm>
 #include <iostream>
 
+#include "SpriteEval.hpp"
+
 namespace MedNES {
 
 void PPU::tick() {
@@ -10,6 +15,7 @@ void PPU::tick() {
             //clear vbl flag and sprite overflow
             if (dot == 2) {
                 pixelIndex = 0;
+                startFrame();
                 ppustatus.val &= ~0x80;
                 ppustatus.val &= ~0x20;
                 ppustatus.val &= ~64;
@@ -62,6 +68,7 @@ void PPU::tick() {
     } else if (scanLine >= 240 && scanLine <= 260) {  //post-render, vblank
         if (scanLine == 240 && dot == 0) {
             generateFrame = true;
+            frameDrawn = drawing;
         }
 
         if (scanLine == 241 && dot == 1) {
@@ -75,6 +82,8 @@ void PPU::tick() {
         }
     }
 
+    clock += PPU_CLOCK_DIVIDER;
+
     if (dot == 340) {
         scanLine = (scanLine + 1) % 262;
         if (scanLine == 0) {
@@ -86,6 +95,191 @@ void PPU::tick() {
     }
 }
 
+void PPU::catchUp(u64 masterClock) {
+    //every register write and mapper write syncs first, so a line that ends
+    //before masterClock can't be changed halfway and is drawn in one go
+    const u64 lineClocks = (DOTS_PER_SCANLINE - 1) * PPU_CLOCK_DIVIDER;
+
+    while (clock < masterClock) {
+        if (scanlineRendering && dot == 0 && clock + lineClocks < masterClock) {
+            if (scanLine <= 239) {
+                renderScanline();
+                continue;
+            }
+
+            //nothing happens on these vblank lines
+            if (scanLine >= 242 && scanLine <= 260) {
+                clock += DOTS_PER_SCANLINE * PPU_CLOCK_DIVIDER;
+                scanLine++;
+                continue;
+            }
+        }
+
+        tick();
+    }
+}
+
+//Visible line from dot 0 through 340, same steps and results as tick() but
+//grouped by phase: sprite work for the next line doesn't touch the
+//background pipeline or the sprites being drawn until dot 257
+void PPU::renderScanline() {
+    //dots 1-256 of sprite evaluation, the overflow flag can't be seen before
+    //the line ends
+    evaluateSprites();
+
+    if (overflowDot != 0) {
+        ppustatus.val |= 0x20;
+        overflowDot = 0;
+    }
+
+    //dots 1-256, the background is collected and composed with the sprites
+    //after the last pixel. A skipped frame only does that for lines that can
+    //have a sprite 0 hit.
+    bool rendering = !isRenderingDisabled();
+    bool layout = rendering && (drawing || spriteZeroHitPossible());
+
+    if (layout) {
+        rasterizeSprites();
+    }
+
+    if (rendering) {
+        for (dot = 1; dot <= 256; dot++) {
+            if (dot >= 2) {
+                reloadShiftersAndShift();
+
+                if (layout) {
+                    layers.background[dot - 2] = backgroundPixel();
+                }
+            }
+
+            fetchTiles();
+        }
+    }
+
+    //dot 257, the last pixel is drawn after the sprite list is cleared
+    dot = 257;
+    fetchSprite();
+    copyHorizontalBits();
+
+    if (rendering) {
+        reloadShiftersAndShift();
+        layers.background[255] = backgroundPixel();
+        fetchTiles();
+    }
+
+    if (layout) {
+        composePixels();
+    } else if (!rendering && drawing) {
+        //the backdrop colour, what the NES shows with rendering off
+        static const u8 backdrop[256] = {0};
+        drawLine(backdrop);
+    } else {
+        pixelIndex += 256;
+    }
+
+    //dots 258-320
+    for (dot = 258; dot <= 320; dot++) {
+        fetchSprite();
+    }
+
+    //dots 321-337
+    if (!isRenderingDisabled()) {
+        for (dot = 321; dot <= 337; dot++) {
+            if (dot >= 322) {
+                reloadShiftersAndShift();
+            }
+
+            fetchTiles();
+        }
+    }
+
+    clock += DOTS_PER_SCANLINE * PPU_CLOCK_DIVIDER;
+    scanLine++;
+    dot = 0;
+}
+
+//Pre-render line, decide whether the coming frame is drawn
+void PPU::startFrame() {
+    frameNumber++;
+    drawing = frameRequested || (drawInterval > 0 && frameNumber % drawInterval == 0);
+    frameRequested = false;
+}
+
+//Sprite 0 is on the line and the flag isn't set yet
+bool PPU::spriteZeroHitPossible() {
+    if (ppustatus.spriteZeroHit || !ppumask.showBg || !ppumask.showSprites) {
+        return false;
+    }
+
+    return std::any_of(spriteRenderEntities.begin(), spriteRenderEntities.end(),
+                       [](const SpriteRenderEntity &sprite) { return sprite.id == 0; });
+}
+
+//Master clock just after the PPU next processes the given dot
+u64 PPU::clockAtDot(int targetLine, int targetDot) {
+    const int frameDots = DOTS_PER_SCANLINE * SCANLINES_PER_FRAME;
+    int current = scanLine * DOTS_PER_SCANLINE + dot;
+    int target = targetLine * DOTS_PER_SCANLINE + targetDot;
+    int dots = (target - current + frameDots) % frameDots + 1;
+
+    return clock + dots * PPU_CLOCK_DIVIDER;
+}
+
+void PPU::scheduleEvents(Scheduler &scheduler) {
+    scheduler.schedule(Scheduler::FRAME_START, clockAtDot(240, 0));
+    scheduler.schedule(Scheduler::VBLANK_START, clockAtDot(241, 1));
+    scheduler.schedule(Scheduler::VBLANK_END, clockAtDot(261, 2));
+}
+
+//Only sprite zero hit and sprite overflow are set outside the vblank events,
+//and only while the PPU draws lines 0-239 with rendering on
+u64 PPU::nextStatusChange() {
+    u64 next = Scheduler::NEVER;
+
+    if (!ppustatus.spriteZeroHit && ppumask.showBg && ppumask.showSprites) {
+        //the first hit can come from dot 2 of line 0
+        if (scanLine < 240 && !(scanLine == 0 && dot <= 1)) {
+            return clock;
+        }
+
+        next = clockAtDot(0, 1) + 1;
+    }
+
+    if (!ppustatus.spriteOverflow && !isRenderingDisabled()) {
+        next = std::min(next, nextOverflow());
+    }
+
+    return next;
+}
+
+//Earliest master clock the overflow flag goes up at if OAM stays as it is
+u64 PPU::nextOverflow() {
+    //this line was evaluated on dot 65 and may still have it pending
+    if (scanLine < 240 && dot > 65 && overflowDot != 0) {
+        return clockAtDot(scanLine, overflowDot - 1) + 1;
+    }
+
+    if (overflowDotsStale) {
+        for (int line = 0; line < 240; line++) {
+            overflowDots[line] = evaluateLine(line, nullptr);
+        }
+
+        overflowDotsStale = false;
+    }
+
+    int first = scanLine < 240 && dot <= 65 ? scanLine : scanLine + 1;
+
+    for (int i = 0; i < 240; i++) {
+        int line = (first + i) % 240;
+
+        if (overflowDots[line] != 0) {
+            return clockAtDot(line, overflowDots[line] - 1) + 1;
+        }
+    }
+
+    return Scheduler::NEVER;
+}
+
 inline void PPU::xIncrement() {
     if ((v & 0x001F) == 31) {
         v &= ~0x001F;
@@ -148,10 +342,10 @@ inline void PPU::fetchTiles() {
 
     //Fetch nametable byte
     if (cycle == 1) {
-        ntbyte = ppuread(0x2000 | (v & 0x0FFF));
+        ntbyte = nametables.at(v);
         //Fetch attribute byte, also calculate which quadrant of the attribute byte is active
     } else if (cycle == 3) {
-        attrbyte = ppuread(0x23C0 | (v & 0x0C00) | ((v >> 4) & 0x38) | ((v >> 2) & 0x07));
+        attrbyte = nametables.at(0x23C0 | (v & 0x0C00) | ((v >> 4) & 0x38) | ((v >> 2) & 0x07));
         quadrant_num = (((v & 2) >> 1) | ((v & 64) >> 5)) * 2;
         //Get low order bits of background tile
     } else if (cycle == 5) {
@@ -159,14 +353,14 @@ inline void PPU::fetchTiles() {
             ((u16)ppuctrl.bgPatternTableAddress << 12) +
             ((u16)ntbyte << 4) +
             ((v & 0x7000) >> 12);
-        patternlow = ppuread(patterAddr);
+        patternlow = tileCache.row(patterAddr).lo;
         //Get high order bits of background tile
     } else if (cycle == 7) {
         u16 patterAddr =
             ((u16)ppuctrl.bgPatternTableAddress << 12) +
             ((u16)ntbyte << 4) +
             ((v & 0x7000) >> 12) + 8;
-        patternhigh = ppuread(patterAddr);
+        patternhigh = tileCache.row(patterAddr).hi;
         //Change columns, change rows
     } else if (cycle == 0) {
         if (dot == 256) {
@@ -177,9 +371,15 @@ inline void PPU::fetchTiles() {
     }
 }
 
-inline void PPU::emitPixel() {
+void PPU::emitPixel() {
     if (isRenderingDisabled()) {
-        pixelIndex++;
+        //the backdrop colour, what the NES shows with rendering off
+        if (drawing) {
+            drawPixel(0);
+        } else {
+            pixelIndex++;
+        }
+
         return;
     }
 
@@ -192,8 +392,6 @@ inline void PPU::emitPixel() {
     u8 bgBit12 = (pixel2 >> 14) | (pixel1 >> 15);
 
     //Sprites
-    u8 spritePixel1 = 0;
-    u8 spritePixel2 = 0;
     u8 spritePixel3 = 0;
     u8 spritePixel4 = 0;
     u8 spriteBit12 = 0;
@@ -209,11 +407,9 @@ inline void PPU::emitPixel() {
                 continue;
             }
 
-            spritePixel1 = sprite.flipHorizontally ? ((sprite.lo & 1) << 7) : sprite.lo & 128;
-            spritePixel2 = sprite.flipHorizontally ? ((sprite.hi & 1) << 7) : sprite.hi & 128;
             spritePixel3 = sprite.attr & 1;
             spritePixel4 = sprite.attr & 2;
-            spriteBit12 = (spritePixel2 >> 6) | (spritePixel1 >> 7);
+            spriteBit12 = sprite.pixels >> 14;
 
             //Sprite zero hit
             if (!ppustatus.spriteZeroHit && spriteBit12 && bgBit12 && sprite.id == 0 && ppumask.showSprites && ppumask.showBg && dot < 256) {
@@ -235,17 +431,126 @@ inline void PPU::emitPixel() {
         paletteIndex = 0;
     }
 
-    u8 pindex = ppuread(0x3F00 | (showSprite ? spritePaletteIndex : paletteIndex)) % 64;
-    //Handling grayscale mode
-    u8 p = ppumask.greyScale ? (pindex & 0x30) : pindex;
+    //skipped frames still need the sprite 0 hit and the sprite shifts above
+    if (!drawing) {
+        pixelIndex++;
+        return;
+    }
+
+    drawPixel(showSprite ? spritePaletteIndex : paletteIndex);
+}
 
+//A palette RAM index into the frame at dot - 2 of the line
+inline void PPU::drawPixel(u8 index) {
     //Dark border rect to hide seam of scroll, and other glitches that may occur
-    if (dot <= 9 || dot >= 249 || scanLine <= 7 || scanLine >= 232) {
-        showSprite = false;
-        p = 13;
+    bool border = dot <= 9 || dot >= 249 || scanLine <= 7 || scanLine >= 232;
+    int column = pixelIndex & 255;
+
+    if (pixelFormat == PixelFormat::INDEXED8) {
+        frameLine<u8>()[column] = border ? (u8)BORDER_INDEX : outputIndices[index];
+    } else if (pixelFormat == PixelFormat::INDEXED16) {
+        frameLine<u16>()[column] = border ? BORDER_INDEX : outputIndices16[index];
+    } else {
+        frameLine<u32>()[column] = border ? borderColor : outputColors[index];
     }
 
-    buffer[pixelIndex++] = palette[p];
+    pixelIndex++;
+}
+
+//Attribute and pattern bits of the pixel under fine x, as emitPixel picks them
+inline u8 PPU::backgroundPixel() {
+    int bit = 15 - x;
+    return ((bgShiftRegLo >> bit) & 1) |
+           (((bgShiftRegHi >> bit) & 1) << 1) |
+           (((attrShiftReg1 >> bit) & 1) << 2) |
+           (((attrShiftReg2 >> bit) & 1) << 3);
+}
+
+//Sprite layer of a visible line. Like emitPixel the first opaque sprite in the
+//list takes a pixel, and a sprite starts one pixel before its counter runs out.
+void PPU::rasterizeSprites() {
+    memset(layers.sprite, 0, sizeof(layers.sprite));
+    memset(layers.spriteFlags, 0, sizeof(layers.spriteFlags));
+
+    for (const auto &sprite : spriteRenderEntities) {
+        int start = 0;
+
+        //counters don't count down on line 0
+        if (scanLine > 0) {
+            start = sprite.counter > 0 ? sprite.counter - 1 : 0;
+        } else if (sprite.counter > 0) {
+            continue;
+        }
+
+        //the list is cleared before the last pixel
+        int end = std::min(start + 8 - sprite.shifted, 255);
+        u16 pixels = sprite.pixels;
+
+        for (int i = start; i < end; i++, pixels <<= 2) {
+            u8 bits = pixels >> 14;
+
+            if (bits == 0 || layers.sprite[i] != 0) {
+                continue;
+            }
+
+            layers.sprite[i] = 0x10 | ((sprite.attr & 3) << 2) | bits;
+            layers.spriteFlags[i] = (sprite.attr & 32) ? LineLayers::BEHIND_BACKGROUND : 0;
+
+            //no hit on the last two pixels
+            if (sprite.id == 0 && i < 254) {
+                layers.spriteFlags[i] |= LineLayers::SPRITE_ZERO;
+            }
+        }
+    }
+}
+
+//A composed line through the output table, with the dark border of emitPixel
+template <typename Pixel>
+static void writeLine(Pixel *line, const u8 *indices, const Pixel *output, Pixel border, bool borderLine) {
+    if (borderLine) {
+        std::fill(line, line + 256, border);
+        return;
+    }
+
+    std::fill(line, line + 8, border);
+
+    for (int i = 8; i < 247; i++) {
+        line[i] = output[indices[i]];
+    }
+
+    std::fill(line + 247, line + 256, border);
+}
+
+//Merge the line layers into the frame buffer
+void PPU::composePixels() {
+    u8 indices[256];
+
+    if (composeLine(layers, ppumask.showBg, ppumask.showSprites, indices)) {
+        ppustatus.val |= 64;
+    }
+
+    //skipped frames only come here for the sprite 0 hit
+    if (!drawing) {
+        pixelIndex += 256;
+        return;
+    }
+
+    drawLine(indices);
+}
+
+//A line of palette RAM indices into the frame
+void PPU::drawLine(const u8 *indices) {
+    bool borderLine = scanLine <= 7 || scanLine >= 232;
+
+    if (pixelFormat == PixelFormat::INDEXED8) {
+        writeLine(frameLine<u8>(), indices, outputIndices, BORDER_INDEX, borderLine);
+    } else if (pixelFormat == PixelFormat::INDEXED16) {
+        writeLine(frameLine<u16>(), indices, outputIndices16, (u16)BORDER_INDEX, borderLine);
+    } else {
+        writeLine(frameLine<u32>(), indices, outputColors, borderColor, borderLine);
+    }
+
+    pixelIndex += 256;
 }
 
 inline void PPU::copyHorizontalBits() {
@@ -312,10 +617,22 @@ void PPU::write(u16 address, u8 data) {
 
     if (address == 0) {
         t = (t & 0xF3FF) | (((u16)data & 0x03) << 10);
-        spriteHeight = (data & 0x20) ? 16 : 8;
+        int height = (data & 0x20) ? 16 : 8;
+
+        if (height != spriteHeight) {
+            spriteHeight = height;
+            overflowDotsStale = true;
+        }
+
         ppuctrl.val = data;
     } else if (address == 1) {
+        u8 changed = ppumask.val ^ data;
         ppumask.val = data;
+
+        //greyscale and emphasis, emphasis isn't applied to colours yet
+        if (changed & 0xE1) {
+            updateOutputColors();
+        }
     } else if (address == 2) {
         data &= ~128;
         ppustatus.val &= 128;
@@ -363,33 +680,7 @@ u8 PPU::ppuread(u16 address) {
             return mapper->ppuread(address);
             break;
         case 0x2000 ... 0x2FFF:
-            //Horizontal
-            if (mapper->getMirroring() == 0) {
-                if (address >= 0x2400 && address < 0x2800) {
-                    address -= 0x400;
-                }
-
-                if (address >= 0x2800 && address < 0x2c00) {
-                    address -= 0x400;
-                }
-
-                if (address >= 0x2c00 && address < 0x3000) {
-                    address -= 0x800;
-                }
-                //Vertical
-            } else if (mapper->getMirroring() == 1) {
-                if (address >= 0x2800 && address < 0x3000) {
-                    address -= 0x800;
-                }
-                //One-screen mirroring, lower-bank (MMC1)
-            } else if (mapper->getMirroring() == 2) {
-                address &= ~0xC00;
-                //One-screen mirroring, upper-bank (MMC1)
-            } else {
-                address = (address & ~0xC00) + 0x400;
-            }
-
-            return vram[address - 0x2000];
+            return nametables.at(address);
             break;
         case 0x3F00 ... 0x3F0F:
             if (address == 0x3F04 || address == 0x3F08 || address == 0x3F0C) {
@@ -422,36 +713,11 @@ void PPU::ppuwrite(u16 address, u8 data) {
             mapper->ppuwrite(address, data);
             break;
         case 0x2000 ... 0x2FFF:
-            //Horizontal
-            if (mapper->getMirroring() == 0) {
-                if (address >= 0x2400 && address < 0x2800) {
-                    address -= 0x400;
-                }
-
-                if (address >= 0x2800 && address < 0x2c00) {
-                    address -= 0x400;
-                }
-
-                if (address >= 0x2c00 && address < 0x3000) {
-                    address -= 0x800;
-                }
-                //Vertical
-            } else if (mapper->getMirroring() == 1) {
-                if (address >= 0x2800 && address < 0x3000) {
-                    address -= 0x800;
-                }
-                //One-screen mirroring, lower-bank (MMC1)
-            } else if (mapper->getMirroring() == 2) {
-                address &= ~0xC00;
-                //One-screen mirroring, upper-bank (MMC1)
-            } else {
-                address = (address & ~0xC00) + 0x400;
-            }
-
-            vram[address - 0x2000] = data;
+            nametables.at(address) = data;
             break;
         case 0x3F00 ... 0x3F0F:
             bg_palette[address - 0x3F00] = data;
+            updateOutputColors();
             break;
         case 0x3F10 ... 0x3F1F:
             if (address == 0x3F10 || address == 0x3F14 || address == 0x3F18 || address == 0x3F1C) {
@@ -460,6 +726,7 @@ void PPU::ppuwrite(u16 address, u8 data) {
                 sprite_palette[address - 0x3F10] = data;
             }
 
+            updateOutputColors();
             break;
         case 0x3000 ... 0x3EFF:
             ppuwrite(address - 0x1000, data);
@@ -469,36 +736,110 @@ void PPU::ppuwrite(u16 address, u8 data) {
     }
 }
 
-void PPU::copyOAM(u8 oamEntry, int index) {
-    int oamSelect = index / 4;
-    int property = index % 4;
-
-    if (property == 0) {
-        primaryOAM[oamSelect].y = oamEntry;
-    } else if (property == 1) {
-        primaryOAM[oamSelect].tileNum = oamEntry;
-    } else if (property == 2) {
-        primaryOAM[oamSelect].attr = oamEntry;
-    } else {
-        primaryOAM[oamSelect].x = oamEntry;
+//Final colour and colour index of every palette RAM index
+void PPU::updateOutputColors() {
+    u16 emphasis = (ppumask.val >> 5) << 6;
+
+    for (int i = 0; i < 32; i++) {
+        u8 pindex = ppuread(0x3F00 | i) % 64;
+        //Handling grayscale mode
+        u8 p = ppumask.greyScale ? (pindex & 0x30) : pindex;
+        outputColors[i] = toPixelFormat(palette[p], pixelFormat);
+        outputIndices[i] = p;
+        outputIndices16[i] = p | emphasis;
     }
+
+    borderColor = toPixelFormat(palette[BORDER_INDEX], pixelFormat);
 }
 
-u8 PPU::readOAM(int index) {
-    int oamSelect = index / 4;
-    int property = index % 4;
-
-    if (property == 0) {
-        return primaryOAM[oamSelect].y;
-    } else if (property == 1) {
-        return primaryOAM[oamSelect].tileNum;
-    } else if (property == 2) {
-        return primaryOAM[oamSelect].attr;
-    } else {
-        return primaryOAM[oamSelect].x;
+void PPU::setPixelFormat(PixelFormat format) {
+    pixelFormat = format;
+    updateOutputColors();
+
+    if (!hasFrameTarget) {
+        framePitch = 256 * bytesPerPixel(format);
     }
 }
 
+void PPU::setFrameTarget(const FrameTarget &target) {
+    frameRows = static_cast<u8 *>(target.pixels);
+    framePitch = target.pitch;
+    hasFrameTarget = true;
+
+    if (target.format != pixelFormat) {
+        pixelFormat = target.format;
+        updateOutputColors();
+    }
+}
+
+void PPU::clearFrameTarget() {
+    frameRows = reinterpret_cast<u8 *>(buffer);
+    framePitch = 256 * bytesPerPixel(pixelFormat);
+    hasFrameTarget = false;
+}
+
+int PPU::bytesPerPixel(PixelFormat format) {
+    switch (format) {
+        case PixelFormat::INDEXED8:
+            return 1;
+        case PixelFormat::INDEXED16:
+            return 2;
+        default:
+            return 4;
+    }
+}
+
+//RGB formats other than ABGR are left as ARGB
+u32 PPU::toPixelFormat(u32 argb, PixelFormat format) {
+    if (format == PixelFormat::ABGR8888) {
+        return (argb & 0xFF00FF00) | ((argb >> 16) & 0xFF) | ((argb & 0xFF) << 16);
+    }
+
+    return argb;
+}
+
+void PPU::convertFrame(u32 *out, PixelFormat format) {
+    u32 colors[64];
+
+    for (int i = 0; i < 64; i++) {
+        colors[i] = toPixelFormat(palette[i], format);
+    }
+
+    for (int line = 0; line < 240; line++, out += 256) {
+        const u8 *row = frameRows + line * framePitch;
+
+        if (pixelFormat == PixelFormat::INDEXED8) {
+            expandIndices(row, 256, colors, out);
+        } else if (pixelFormat == PixelFormat::INDEXED16) {
+            expandIndices(reinterpret_cast<const u16 *>(row), 256, colors, out);
+        } else if (pixelFormat == format) {
+            memcpy(out, row, 256 * sizeof(u32));
+        } else {
+            //ARGB and ABGR differ by the same swap both ways
+            const u32 *pixels = reinterpret_cast<const u32 *>(row);
+
+            for (int i = 0; i < 256; i++) {
+                out[i] = toPixelFormat(pixels[i], PixelFormat::ABGR8888);
+            }
+        }
+    }
+}
+
+void PPU::copyOAM(u8 oamEntry, int index) {
+    oam[index] = oamEntry;
+    overflowDotsStale = true;
+}
+
+//OAM DMA
+void PPU::copyOAMPage(const u8 *page) {
+    memcpy(oam, page, sizeof(oam));
+    overflowDotsStale = true;
+}
+
+u8 PPU::readOAM(int index) {
+    return oam[index];
+}
+
 inline void PPU::decrementSpriteCounters() {
     if (isRenderingDisabled()) {
         return;
@@ -516,131 +857,149 @@ bool PPU::isUninit(const Sprite &sprite) {
 }
 
 void PPU::evalSprites() {
-    //clear secondary OAM
-    if (dot >= 1 && dot <= 64) {
-        if (dot == 1) {
-            secondaryOAMCursor = 0;
-        }
+    //secondary OAM is cleared on dots 1-64 and filled on 65-256, nothing but
+    //the sprite fetches reads it so the whole line is evaluated at once
+    if (dot == 65) {
+        evaluateSprites();
+    }
 
-        secondaryOAM[secondaryOAMCursor].attr = 0xFF;
-        secondaryOAM[secondaryOAMCursor].tileNum = 0xFF;
-        secondaryOAM[secondaryOAMCursor].x = 0xFF;
-        secondaryOAM[secondaryOAMCursor].y = 0xFF;
+    if (dot == overflowDot && overflowDot != 0) {
+        ppustatus.val |= 0x20;
+        overflowDot = 0;
+    }
 
-        if (dot % 8 == 0) {
-            secondaryOAMCursor++;
-        }
+    //Sprite fetches
+    if (dot >= 257 && dot <= 320) {
+        fetchSprite();
+    }
+}
+
+//Fill secondary OAM for this line and note when the overflow flag goes up
+void PPU::evaluateSprites() {
+    for (auto &sprite : secondaryOAM) {
+        sprite.attr = 0xFF;
+        sprite.tileNum = 0xFF;
+        sprite.x = 0xFF;
+        sprite.y = 0xFF;
     }
 
-    //sprite eval
-    if (dot >= 65 && dot <= 256) {
-        //Init
-        if (dot == 65) {
-            secondaryOAMCursor = 0;
-            primaryOAMCursor = 0;
+    int overflow = evaluateLine(scanLine, secondaryOAM);
+    overflowDot = isRenderingDisabled() ? 0 : overflow;
+}
+
+//Copies the first 8 sprites on line in OAM order to found, when given.
+//Returns the dot the overflow flag goes up on, 0 if there's no overflow.
+int PPU::evaluateLine(int line, Sprite *found) {
+    u64 onLine = spritesOnLine(oam, line, spriteHeight);
+    int count = 0;
+
+    while (onLine != 0) {
+        int n = __builtin_ctzll(onLine);
+        onLine &= onLine - 1;
+
+        Sprite sprite = {oam[n * 4], oam[n * 4 + 1], oam[n * 4 + 2], oam[n * 4 + 3], (u8)n};
+
+        if (isUninit(sprite)) {
+            continue;
         }
 
-        if (secondaryOAMCursor == 8) {
-            //ppustatus |= 0x20;
-            return;
+        if (found != nullptr) {
+            found[count] = sprite;
         }
 
-        if (primaryOAMCursor == 64) {
-            return;
+        if (++count == 8) {
+            return overflowScan(n + 1, line);
         }
+    }
 
-        //odd cycle read
-        if ((dot % 2) == 1) {
-            tmpOAM = primaryOAM[primaryOAMCursor];
+    return 0;
+}
 
-            if (inYRange(tmpOAM)) {
-                inRangeCycles--;
-                inRange = true;
-            }
-            //even cycle write
-        } else {
-            //tmpOAM is in range, write it to secondaryOAM
-            if (inRange) {
-                inRangeCycles--;
-
-                //copying tmpOAM in range is 8 cycles, 2 cycles otherwise
-                if (inRangeCycles == 0) {
-                    primaryOAMCursor++;
-                    secondaryOAMCursor++;
-                    inRangeCycles = 8;
-                    inRange = false;
-                } else {
-                    tmpOAM.id = primaryOAMCursor;
-                    secondaryOAM[secondaryOAMCursor] = tmpOAM;
-                }
-            } else {
-                primaryOAMCursor++;
-            }
+//After the 8th sprite the PPU keeps reading Y for the overflow flag, but it
+//steps the byte within a sprite along with the sprite, so it also takes tile
+//numbers, attributes and x positions for Y. Each sprite read so far took 2
+//dots, the 8 copied took 6 more.
+int PPU::overflowScan(int n, int line) {
+    for (int m = 0; n < 64; n++, m = (m + 1) & 3) {
+        int y = oam[n * 4 + m];
+
+        if (line >= y && line < y + spriteHeight) {
+            return 65 + n * 2 + 8 * 6;
         }
     }
 
-    //Sprite fetches
-    if (dot >= 257 && dot <= 320) {
-        if (dot == 257) {
-            secondaryOAMCursor = 0;
-            spriteRenderEntities.clear();
-        }
+    return 0;
+}
 
-        Sprite sprite = secondaryOAM[secondaryOAMCursor];
+inline void PPU::fetchSprite() {
+    if (dot == 257) {
+        secondaryOAMCursor = 0;
+        spriteRenderEntities.clear();
+    }
 
-        int cycle = (dot - 1) % 8;
+    Sprite sprite = secondaryOAM[secondaryOAMCursor];
 
-        switch (cycle) {
-            case 0 ... 1:
-                if (!isUninit(sprite)) {
-                    out = SpriteRenderEntity();
-                }
+    int cycle = (dot - 1) % 8;
 
-                break;
+    switch (cycle) {
+        case 0 ... 1:
+            if (!isUninit(sprite)) {
+                out = SpriteRenderEntity();
+            }
 
-            case 2:
-                if (!isUninit(sprite)) {
-                    out.attr = sprite.attr;
-                    out.flipHorizontally = sprite.attr & 64;
-                    out.flipVertically = sprite.attr & 128;
-                    out.id = sprite.id;
-                }
-                break;
+            break;
 
-            case 3:
-                if (!isUninit(sprite)) {
-                    out.counter = sprite.x;
-                }
-                break;
+        case 2:
+            if (!isUninit(sprite)) {
+                out.attr = sprite.attr;
+                out.flipHorizontally = sprite.attr & 64;
+                out.flipVertically = sprite.attr & 128;
+                out.id = sprite.id;
+            }
+            break;
 
-            case 4:
-                if (!isUninit(sprite)) {
-                    spritePatternLowAddr = getSpritePatternAddress(sprite, out.flipVertically);
-                    out.lo = ppuread(spritePatternLowAddr);
-                }
-                break;
+        case 3:
+            if (!isUninit(sprite)) {
+                out.counter = sprite.x;
+            }
+            break;
 
-            case 5:
-                break;
+        case 4:
+            if (!isUninit(sprite)) {
+                spritePatternLowAddr = getSpritePatternAddress(sprite, out.flipVertically);
+                out.lo = tileCache.row(spritePatternLowAddr).lo;
+            }
+            break;
 
-            case 6:
-                if (!isUninit(sprite)) {
-                    spritePatternHighAddr = spritePatternLowAddr + 8;
-                    out.hi = ppuread(spritePatternHighAddr);
-                }
-                break;
+        case 5:
+            break;
 
-            case 7:
-                if (!isUninit(sprite)) {
-                    spriteRenderEntities.push_back(out);
+        case 6:
+            if (!isUninit(sprite)) {
+                spritePatternHighAddr = spritePatternLowAddr + 8;
+                const TileRow &row = tileCache.row(spritePatternHighAddr);
+                out.hi = row.hi;
+
+                //a bank switch between the two plane fetches mixes two tiles
+                if (row.lo != out.lo) {
+                    TileRow mixed = TileCache::decode(out.lo, out.hi);
+                    out.pixels = out.flipHorizontally ? mixed.flipped : mixed.pixels;
+                } else {
+                    out.pixels = out.flipHorizontally ? row.flipped : row.pixels;
                 }
+            }
+            break;
 
-                secondaryOAMCursor++;
-                break;
+        case 7:
+            if (!isUninit(sprite)) {
+                spriteRenderEntities.push_back(out);
+            }
 
-            default:
-                break;
-        }
+            secondaryOAMCursor++;
+            break;
+
+        default:
+            break;
     }
 }
 
@@ -671,8 +1030,97 @@ u16 PPU::getSpritePatternAddress(const Sprite &sprite, bool flipVertically) {
     return addr;
 }
 
-bool PPU::inYRange(const Sprite &oam) {
-    return !isUninit(oam) && ((scanLine >= oam.y) && (scanLine < (oam.y + spriteHeight)));
+void PPU::saveState(PPUState &state) {
+    state.clock = clock;
+    state.scanLine = scanLine;
+    state.dot = dot;
+    state.pixelIndex = pixelIndex;
+    state.w = w;
+    state.secondaryOAMCursor = secondaryOAMCursor;
+    state.overflowDot = overflowDot;
+    state.spriteHeight = spriteHeight;
+    state.v = v;
+    state.t = t;
+    state.bgShiftRegLo = bgShiftRegLo;
+    state.bgShiftRegHi = bgShiftRegHi;
+    state.attrShiftReg1 = attrShiftReg1;
+    state.attrShiftReg2 = attrShiftReg2;
+    state.spritePatternLowAddr = spritePatternLowAddr;
+    state.spritePatternHighAddr = spritePatternHighAddr;
+    state.ppuctrl = ppuctrl.val;
+    state.ppumask = ppumask.val;
+    state.ppustatus = ppustatus.val;
+    state.ppustatusCopy = ppustatus_cpy;
+    state.oamaddr = oamaddr;
+    state.oamdata = oamdata;
+    state.ppuscroll = ppuscroll;
+    state.readBuffer = ppu_read_buffer;
+    state.readBufferCopy = ppu_read_buffer_cpy;
+    state.x = x;
+    state.ntbyte = ntbyte;
+    state.attrbyte = attrbyte;
+    state.patternlow = patternlow;
+    state.patternhigh = patternhigh;
+    state.quadrant = quadrant_num;
+    state.odd = odd;
+    state.nmiOccured = nmiOccured;
+    state.generateFrame = generateFrame;
+    memcpy(state.bgPalette, bg_palette, sizeof(bg_palette));
+    memcpy(state.spritePalette, sprite_palette, sizeof(sprite_palette));
+    memcpy(state.vram, vram, sizeof(vram));
+    memcpy(state.oam, oam, sizeof(oam));
+    memcpy(state.secondaryOAM, secondaryOAM, sizeof(secondaryOAM));
+
+    //at most one entity per secondary OAM slot
+    state.spriteCount = spriteRenderEntities.size();
+    std::copy(spriteRenderEntities.begin(), spriteRenderEntities.end(), state.sprites);
+    state.out = out;
+}
+
+void PPU::loadState(const PPUState &state) {
+    clock = state.clock;
+    scanLine = state.scanLine;
+    dot = state.dot;
+    pixelIndex = state.pixelIndex;
+    w = state.w;
+    secondaryOAMCursor = state.secondaryOAMCursor;
+    overflowDot = state.overflowDot;
+    spriteHeight = state.spriteHeight;
+    v = state.v;
+    t = state.t;
+    bgShiftRegLo = state.bgShiftRegLo;
+    bgShiftRegHi = state.bgShiftRegHi;
+    attrShiftReg1 = state.attrShiftReg1;
+    attrShiftReg2 = state.attrShiftReg2;
+    spritePatternLowAddr = state.spritePatternLowAddr;
+    spritePatternHighAddr = state.spritePatternHighAddr;
+    ppuctrl.val = state.ppuctrl;
+    ppumask.val = state.ppumask;
+    ppustatus.val = state.ppustatus;
+    ppustatus_cpy = state.ppustatusCopy;
+    oamaddr = state.oamaddr;
+    oamdata = state.oamdata;
+    ppuscroll = state.ppuscroll;
+    ppu_read_buffer = state.readBuffer;
+    ppu_read_buffer_cpy = state.readBufferCopy;
+    x = state.x;
+    ntbyte = state.ntbyte;
+    attrbyte = state.attrbyte;
+    patternlow = state.patternlow;
+    patternhigh = state.patternhigh;
+    quadrant_num = state.quadrant;
+    odd = state.odd;
+    nmiOccured = state.nmiOccured;
+    generateFrame = state.generateFrame;
+    memcpy(bg_palette, state.bgPalette, sizeof(bg_palette));
+    memcpy(sprite_palette, state.spritePalette, sizeof(sprite_palette));
+    updateOutputColors();
+    memcpy(vram, state.vram, sizeof(vram));
+    memcpy(oam, state.oam, sizeof(oam));
+    overflowDotsStale = true;
+    memcpy(secondaryOAM, state.secondaryOAM, sizeof(secondaryOAM));
+    spriteRenderEntities.assign(state.sprites, state.sprites + std::min<int>(state.spriteCount, 8));
+    out = state.out;
 }
 
 void PPU::printState() {
@@ -3,9 +3,12 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include "Common/Timing.hpp"
 #include "Common/Typedefs.hpp"
+#include "Compositor.hpp"
 #include "INESBus.hpp"
 #include "Mapper/Mapper.hpp"
+#include "Scheduler.hpp"
 
 namespace MedNES {
 
@@ -25,6 +28,8 @@ struct SpriteRenderEntity {
     u8 id;
     bool flipHorizontally;
     bool flipVertically;
+    //2-bit pixels with any flip applied, the next one in the top bits
+    u16 pixels;
     int shifted = 0;
 
     void shift() {
@@ -32,21 +37,84 @@ struct SpriteRenderEntity {
             return;
         }
 
-        if (flipHorizontally) {
-            lo >>= 1;
-            hi >>= 1;
-        } else {
-            lo <<= 1;
-            hi <<= 1;
-        }
-
+        pixels <<= 2;
         shifted++;
     }
 };
 
+//How the frame buffer is laid out. The indexed formats hold NES colour
+//indices, greyscale applied, for consumers that don't need RGB.
+enum class PixelFormat {
+    ARGB8888,   //SDL
+    ABGR8888,   //Android bitmaps
+    INDEXED8,   //colour index per byte in PPU::indices8
+    INDEXED16,  //colour index | emphasis bits << 6 in PPU::indices16
+};
+
+//Memory frames are drawn straight into instead of PPU::buffer, like a locked
+//streaming texture, an ANativeWindow buffer or a view of the wasm heap
+struct FrameTarget {
+    void *pixels;
+    int pitch;  //bytes from one row to the next
+    PixelFormat format;
+};
+
+//Everything the PPU needs to resume, the frame buffer is output and left out
+struct PPUState {
+    u64 clock;
+    s32 scanLine;
+    s32 dot;
+    s32 pixelIndex;
+    s32 w;
+    s32 secondaryOAMCursor;
+    s32 overflowDot;
+    s32 spriteHeight;
+    u16 v;
+    u16 t;
+    u16 bgShiftRegLo;
+    u16 bgShiftRegHi;
+    u16 attrShiftReg1;
+    u16 attrShiftReg2;
+    u16 spritePatternLowAddr;
+    u16 spritePatternHighAddr;
+    u8 ppuctrl;
+    u8 ppumask;
+    u8 ppustatus;
+    u8 ppustatusCopy;
+    u8 oamaddr;
+    u8 oamdata;
+    u8 ppuscroll;
+    u8 readBuffer;
+    u8 readBufferCopy;
+    u8 x;
+    u8 ntbyte;
+    u8 attrbyte;
+    u8 patternlow;
+    u8 patternhigh;
+    u8 quadrant;
+    u8 odd;
+    u8 nmiOccured;
+    u8 generateFrame;
+    u8 spriteCount;
+    u8 bgPalette[16];
+    u8 spritePalette[16];
+    u8 vram[2048];
+    u8 oam[256];
+    Sprite secondaryOAM[8];
+    SpriteRenderEntity sprites[8];
+    SpriteRenderEntity out;
+};
+
 class PPU : public INESBus {
    public:
-    PPU(Mapper *mapper) : mapper(mapper){};
+    PPU(Mapper *mapper) : mapper(mapper) {
+        ppuctrl.val = 0;
+        ppumask.val = 0;
+        ppustatus.val = 0;
+        mapper->setTileCache(&tileCache);
+        mapper->setNametables(&nametables);
+        updateOutputColors();
+    };
 
     //cpu address space
     u8 read(u16 address);
@@ -58,13 +126,60 @@ class PPU : public INESBus {
 
     void tick();
     void copyOAM(u8, int);
+    void copyOAMPage(const u8 *);
     u8 readOAM(int);
     bool genNMI();
-    bool generateFrame;
+    bool generateFrame = false;
+
+    //Catch-up scheduling: the PPU is only run when something can observe it
+    void catchUp(u64 masterClock);
+    void scheduleEvents(Scheduler &);
+
+    //Whole lines are drawn at once when catch-up covers them, off means dot by dot
+    void setScanlineRendering(bool enabled) { scanlineRendering = enabled; }
+
+    //Frame buffer pixels are ARGB unless set otherwise
+    void setPixelFormat(PixelFormat format);
+
+    //Draw into the target, in its pixel format, instead of buffer. Every pixel
+    //of a drawn frame is written. Lines go out as they are drawn, so the
+    //target is swapped once generateFrame is up and before the CPU runs on.
+    void setFrameTarget(const FrameTarget &target);
+    //Back to buffer
+    void clearFrameTarget();
+
+    //Frame skipping: 1 draws every frame, n one frame in n and 0 only the
+    //frames asked for with requestFrame. A skipped frame leaves the frame
+    //buffer alone but sets every flag and register the CPU can see the same.
+    void setDrawInterval(int interval) { drawInterval = interval; }
+    void requestFrame() { frameRequested = true; }
+    //Whether the frame that generateFrame announced was drawn
+    bool isFrameDrawn() { return frameDrawn; }
+
+    //The last frame in ARGB or ABGR, whatever the pixel format, read from
+    //buffer or the frame target. Emphasis isn't applied, same as for RGB output.
+    void convertFrame(u32 *out, PixelFormat format);
+
+    //PPUSTATUS without the read side effects, and the earliest master clock a
+    //read could see it change other than through a scheduled event
+    u8 peekStatus() { return ppustatus.val; }
+    u64 nextStatusChange();
+
+    void saveState(PPUState &);
+    void loadState(const PPUState &);
+
     void printState();
-    uint32_t buffer[256 * 240] = {0};
+
+    //Frame buffer, only the one matching the pixel format is written
+    union {
+        uint32_t buffer[256 * 240] = {0};
+        u8 indices8[256 * 240];
+        u16 indices16[256 * 240];
+    };
 
    private:
+    friend class MicroBench;
+
     //Registers
 
     //$2000 PPUCTRL
@@ -120,6 +235,7 @@ class PPU : public INESBus {
     u8 ppu_read_buffer = 0;
     u8 ppu_read_buffer_cpy = 0;
 
+    //ARGB, converted to the pixel format into outputColors
     u32 palette[64] = {
         4283716692, 4278197876, 4278718608, 4281335944, 4282646628, 4284219440, 4283696128, 4282128384,
         4280297984, 4278729216, 4278206464, 4278205440, 4278202940, 4278190080, 4278190080, 4278190080,
@@ -130,54 +246,102 @@ class PPU : public INESBus {
         4293717740, 4289252588, 4290559212, 4292129516, 4293701356, 4293701332, 4293702832, 4293182608,
         4291613304, 4290043512, 4289258128, 4288209588, 4288730852, 4288717472, 4278190080, 4278190080};
 
+    //palette RAM resolved to output colours and colour indices, rebuilt when
+    //palette RAM, greyscale, emphasis or the pixel format change
+    static const u8 BORDER_INDEX = 13;
+    PixelFormat pixelFormat = PixelFormat::ARGB8888;
+    u32 outputColors[32];
+    u32 borderColor;
+    u8 outputIndices[32];
+    u16 outputIndices16[32];
+
+    //where frame lines go, buffer unless a frame target is set
+    u8 *frameRows = reinterpret_cast<u8 *>(buffer);
+    int framePitch = 256 * sizeof(u32);
+    bool hasFrameTarget = false;
+
     //BG
     u8 bg_palette[16] = {0};
     u8 vram[2048] = {0};
+    NametableMap nametables{vram};
     u16 v = 0, t = 0;
     u8 x = 0;
     int w = 0;
-    u8 ntbyte, attrbyte, patternlow, patternhigh;
-    u16 bgShiftRegLo;
-    u16 bgShiftRegHi;
-    u16 attrShiftReg1;
-    u16 attrShiftReg2;
-    u8 quadrant_num;
+    u8 ntbyte = 0, attrbyte = 0, patternlow = 0, patternhigh = 0;
+    u16 bgShiftRegLo = 0;
+    u16 bgShiftRegHi = 0;
+    u16 attrShiftReg1 = 0;
+    u16 attrShiftReg2 = 0;
+    u8 quadrant_num = 0;
 
     //Sprites
     u8 sprite_palette[16] = {0};
-    u16 spritePatternLowAddr, spritePatternHighAddr;
-    int primaryOAMCursor = 0;
+    u16 spritePatternLowAddr = 0, spritePatternHighAddr = 0;
+    u8 oam[256] = {0};
     int secondaryOAMCursor = 0;
-    Sprite primaryOAM[64];
-    Sprite secondaryOAM[8];
-    Sprite tmpOAM;
-    bool inRange = false;
-    int inRangeCycles = 8;
+    Sprite secondaryOAM[8] = {};
     int spriteHeight = 8;
+    //dot the overflow flag goes up on this line, 0 if it doesn't
+    int overflowDot = 0;
+    //the same for every visible line with OAM as it is, for nextStatusChange
+    u8 overflowDots[240] = {0};
+    bool overflowDotsStale = true;
     std::vector<SpriteRenderEntity> spriteRenderEntities;
-    SpriteRenderEntity out;
+    SpriteRenderEntity out = {};
+
+    //scanline renderer scratch, rebuilt for every line
+    LineLayers layers;
 
     Mapper *mapper;
+    TileCache tileCache;
 
     int scanLine = 0;
     int dot = 0;
+    u64 clock = 0;
     int pixelIndex = 0;
     bool odd = false;
     bool nmiOccured = false;
+    bool scanlineRendering = true;
+
+    //frame skipping, output only and left out of save states
+    int drawInterval = 1;
+    u32 frameNumber = 0;
+    bool frameRequested = false;
+    bool drawing = true;
+    bool frameDrawn = true;
 
     //methods
+    u64 clockAtDot(int, int);
+    void startFrame();
+    bool spriteZeroHitPossible();
+    void updateOutputColors();
+    static u32 toPixelFormat(u32, PixelFormat);
+    static int bytesPerPixel(PixelFormat);
+    //the frame row pixelIndex is on
+    template <typename Pixel>
+    Pixel *frameLine() { return reinterpret_cast<Pixel *>(frameRows + (pixelIndex >> 8) * framePitch); }
+    inline void drawPixel(u8);
+    void drawLine(const u8 *);
     inline void copyHorizontalBits();
     inline void copyVerticalBits();
     inline bool isRenderingDisabled();
-    inline void emitPixel();
+    void emitPixel();
     inline void fetchTiles();
     inline void xIncrement();
     inline void yIncrement();
     inline void reloadShiftersAndShift();
     inline void decrementSpriteCounters();
     u16 getSpritePatternAddress(const Sprite &, bool);
+    void renderScanline();
+    inline u8 backgroundPixel();
+    void rasterizeSprites();
+    void composePixels();
     void evalSprites();
-    bool inYRange(const Sprite &);
+    void evaluateSprites();
+    int evaluateLine(int, Sprite *);
+    int overflowScan(int, int);
+    u64 nextOverflow();
+    inline void fetchSprite();
     bool isUninit(const Sprite &);
 };
 
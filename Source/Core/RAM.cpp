@@ -3,12 +3,12 @@
 namespace MedNES {
 
 u8 RAM::read(u16 address) {
-    address %= 2048;
+    address &= 0x7FF;
     return ram[address];
 }
 
 void RAM::write(u16 address, u8 data) {
-    address %= 2048;
+    address &= 0x7FF;
     ram[address] = data;
 }
 
@@ -12,6 +12,7 @@ class RAM : public INESBus {
    public:
     u8 read(u16 address);
     void write(u16 address, u8 data);
+    u8 *data() { return ram; }
 
     //256 byte pages, 8 pages on internal NES RAM
    private:
@@ -1,9 +1,12 @@
 #include "ROM.hpp"
 
+#include <stdio.h>
+#include <string.h>
+
 #include <algorithm>
-#include <fstream>
 #include <iostream>
 
+#include "Common/Crc32.hpp"
 #include "Mapper/CNROM.hpp"
 #include "Mapper/MMC1.hpp"
 #include "Mapper/NROM.hpp"
@@ -11,75 +14,166 @@
 
 namespace MedNES {
 
-void ROM::open(std::string filePath) {
-    std::ifstream in(filePath, std::ios::binary);
+//NES 2.0 ROM size: a 12-bit count of units, or 2^E * (2M+1) bytes when the
+//high nibble is all ones. Sizes past 4gb are clamped, no file holds them.
+static u32 romSize(u8 lsb, u8 msb, u32 unit) {
+    if (msb == 0xF) {
+        int exponent = lsb >> 2;
+        u64 size = ((u64)1 << std::min(exponent, 40)) * ((lsb & 3) * 2 + 1);
+        return size > 0xFFFFFFFF ? 0xFFFFFFFF : (u32)size;
+    }
 
-    //Read header
-    in.read(reinterpret_cast<char *>(&header.nes), sizeof(char[4]));
-    in.read(reinterpret_cast<char *>(&header.prgIn16kb), sizeof(u8));
-    in.read(reinterpret_cast<char *>(&header.chrIn8kb), sizeof(u8));
-    in.read(reinterpret_cast<char *>(&header.flags6), sizeof(u8));
-    in.read(reinterpret_cast<char *>(&header.flags7), sizeof(u8));
-    in.read(reinterpret_cast<char *>(&header.prgRamIn8kb), sizeof(u8));
-    in.read(reinterpret_cast<char *>(&header.flags9), sizeof(u8));
-    in.read(reinterpret_cast<char *>(&header.flags10), sizeof(u8));
-    in.read(reinterpret_cast<char *>(&header.zeros), sizeof(char[5]));
-
-    trainer.reserve(512);
-    int prgSize = header.prgIn16kb * 16384;
-    int chrSize = header.chrIn8kb * 8192;
-    prgCode.resize(prgSize);
-    chrData.resize(chrSize);
-
-    mirroring = header.flags6 & 1;
-
-    //If trainer present
-    if ((header.flags6 >> 2) & 1) {
-        in.read((char *)trainer.data(), 512);
+    return ((msb << 8) | lsb) * unit;
+}
+
+//NES 2.0 RAM size: 64 << shift bytes, 0 for none
+static u32 ramSize(u8 shift) {
+    return shift != 0 ? 64u << shift : 0;
+}
+
+RomInfo RomInfo::parse(const INESHeader &header) {
+    RomInfo info = {};
+    info.nes20 = (header.flags7 & 0x0C) == 0x08;
+    info.mirroring = header.flags6 & 1;
+    info.battery = header.flags6 & 2;
+    info.trainer = header.flags6 & 4;
+    info.fourScreen = header.flags6 & 8;
+
+    if (info.nes20) {
+        info.mapper = (header.flags6 >> 4) | (header.flags7 & 0xF0) | ((header.flags8 & 0x0F) << 8);
+        info.submapper = header.flags8 >> 4;
+        info.prgRomSize = romSize(header.prgIn16kb, header.flags9 & 0x0F, 16384);
+        info.chrRomSize = romSize(header.chrIn8kb, header.flags9 >> 4, 8192);
+        info.prgRamSize = ramSize(header.flags10 & 0x0F);
+        info.prgNvramSize = ramSize(header.flags10 >> 4);
+        info.chrRamSize = ramSize(header.flags11 & 0x0F);
+        info.chrNvramSize = ramSize(header.flags11 >> 4);
+        info.consoleType = header.flags7 & 3;
+        info.timing = header.flags12 & 3;
+        return info;
     }
 
-    in.read((char *)prgCode.data(), header.prgIn16kb * 16384);
+    //Old dumping tools left a signature in bytes 7-15, flags 7 is junk then
+    bool junk = header.flags12 != 0 || header.flags13 != 0 || header.flags14 != 0 || header.flags15 != 0;
+    u8 flags7 = junk ? 0 : header.flags7;
 
-    if (header.chrIn8kb > 0) {
-        in.read((char *)chrData.data(), header.chrIn8kb * 8192);
+    info.mapper = (header.flags6 >> 4) | (flags7 & 0xF0);
+    info.prgRomSize = header.prgIn16kb * 16384;
+    info.chrRomSize = header.chrIn8kb * 8192;
+    info.chrRamSize = info.chrRomSize == 0 ? 0x2000 : 0;
+    info.consoleType = flags7 & 3;
+    info.timing = !junk && (header.flags9 & 1) ? 1 : 0;
+
+    //0 means 8kb, for games that predate the field
+    u32 prgRam = (junk || header.flags8 == 0 ? 1 : header.flags8) * 0x2000;
+
+    if (info.battery) {
+        info.prgNvramSize = prgRam;
     } else {
-        chrData = std::vector<u8>(8192, 0);
+        info.prgRamSize = prgRam;
     }
+
+    return info;
+}
+
+void ROM::open(std::string filePath) {
+    info = RomInfo();
+    cartridge = Cartridge();
+    std::shared_ptr<const RomImage> image = RomImage::open(filePath);
+
+    if (image == nullptr || image->size() < sizeof(INESHeader) || memcmp(image->data(), "NES\x1A", 4) != 0) {
+        return;
+    }
+
+    //Read header
+    INESHeader header;
+    memcpy(&header, image->data(), sizeof(INESHeader));
+    info = RomInfo::parse(header);
+
+    //If trainer present, it's skipped
+    u64 prgOffset = sizeof(INESHeader) + (info.trainer ? 512 : 0);
+
+    if (info.prgRomSize == 0 || image->size() < prgOffset + info.prgRomSize + info.chrRomSize) {
+        return;
+    }
+
+    //Boards map whole 8kb PRG and 1kb CHR pages, NES 2.0 exponent sizes
+    //that aren't would have them read past the image
+    if (info.prgRomSize % 0x2000 != 0 || info.chrRomSize % 0x400 != 0) {
+        return;
+    }
+
+    cartridge.image = image;
+    cartridge.prg = image->data() + prgOffset;
+    cartridge.prgSize = info.prgRomSize;
+    //no CHR ROM means CHR RAM, which every mapper allocates itself
+    cartridge.chr = info.chrRomSize > 0 ? cartridge.prg + info.prgRomSize : nullptr;
+    cartridge.chrSize = info.chrRomSize;
+    cartridge.mirroring = info.mirroring;
+
+    //CHR follows PRG, both are hashed in one go
+    info.crc32 = Crc32::compute(cartridge.prg, info.prgRomSize + info.chrRomSize);
+    info.sha1 = Sha1::compute(cartridge.prg, info.prgRomSize + info.chrRomSize);
+    cartridge.crc32 = info.crc32;
 }
 
 void ROM::printHeader() {
     std::cout << "<<Header>>"
               << "\n";
-    std::cout << "Signature: " << header.nes << "\n";
-    std::cout << "PRG ROM (program code) size: " << (int)header.prgIn16kb << " x 16kb \n";
-    std::cout << "CHR ROM (graphical data) size: " << (int)header.chrIn8kb << " x 8kb \n";
-    mapperNum = ((header.flags6 & 0xF0) >> 4) | (header.flags7 & 0xF0);
-    std::bitset<8> flags6Bits(header.flags6);
-    std::bitset<8> flags7Bits(header.flags7);
-    std::cout << "Flags 6: " << flags6Bits << "\n";
-    std::cout << "Flags 7: " << flags7Bits << "\n";
+    std::cout << "Format: " << (info.nes20 ? "NES 2.0" : "iNES") << "\n";
+    std::cout << "Mapper: " << info.mapper;
+
+    //iNES has no submapper
+    if (info.nes20) {
+        std::cout << "." << (int)info.submapper;
+    }
+
+    std::cout << "\n";
+    std::cout << "PRG ROM (program code) size: " << info.prgRomSize / 1024 << "kb \n";
+    std::cout << "CHR ROM (graphical data) size: " << info.chrRomSize / 1024 << "kb \n";
+    std::cout << "PRG RAM size: " << info.prgRamSize / 1024 << "kb, battery backed: " << info.prgNvramSize / 1024 << "kb \n";
+    std::cout << "CHR RAM size: " << info.chrRamSize / 1024 << "kb, battery backed: " << info.chrNvramSize / 1024 << "kb \n";
+    std::cout << "Mirroring: " << (info.fourScreen ? "four screen" : (info.mirroring ? "vertical" : "horizontal")) << "\n";
+    std::cout << "Battery: " << (info.battery ? "yes" : "no") << ", trainer: " << (info.trainer ? "yes" : "no") << "\n";
+
+    char crc[9];
+    snprintf(crc, sizeof(crc), "%08X", info.crc32);
+    std::string sha1;
+
+    for (u8 byte : info.sha1) {
+        char hex[3];
+        snprintf(hex, sizeof(hex), "%02x", byte);
+        sha1 += hex;
+    }
+
+    std::cout << "CRC32: " << crc << "\n";
+    std::cout << "SHA-1: " << sha1 << "\n";
 }
 
 int ROM::getMirroring() {
-    return mirroring;
+    return info.mirroring;
 }
 
 Mapper *ROM::getMapper() {
-    switch (mapperNum) {
+    if (cartridge.image == nullptr) {
+        return NULL;
+    }
+
+    switch (info.mapper) {
         case 0:
-            return new NROM(prgCode, chrData, mirroring);
+            return new NROM(cartridge);
             break;
 
         case 1:
-            return new MMC1(prgCode, chrData, mirroring);
+            return new MMC1(cartridge);
             break;
 
         case 2:
-            return new UnROM(prgCode, chrData, mirroring);
+            return new UnROM(cartridge);
             break;
 
         case 3:
-            return new CNROM(prgCode, chrData, mirroring);
+            return new CNROM(cartridge);
             break;
 
         default:
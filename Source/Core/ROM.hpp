@@ -3,11 +3,12 @@
 #include <stdint.h>
 #include <stdio.h>
 
-#include <bitset>
 #include <string>
 #include <vector>
 
+#include "Common/Sha1.hpp"
 #include "INESBus.hpp"
+#include "RomImage.hpp"
 
 namespace MedNES {
 
@@ -20,28 +21,65 @@ struct INESHeader {
     u8 chrIn8kb;
     u8 flags6;
     u8 flags7;
-    u8 prgRamIn8kb;
+    //iNES: PRG RAM in 8kb, NES 2.0: mapper high bits and submapper
+    u8 flags8;
+    //NES 2.0: size high bits, RAM sizes, timing, console type, misc ROMs,
+    //expansion device. Zero in a clean iNES header.
     u8 flags9;
     u8 flags10;
-    char zeros[5];
+    u8 flags11;
+    u8 flags12;
+    u8 flags13;
+    u8 flags14;
+    u8 flags15;
+};
+
+//What the header says about the cartridge and a stable identity for it that
+//doesn't depend on the file name. Sizes are in bytes.
+struct RomInfo {
+    bool nes20;
+    u16 mapper;
+    u8 submapper;
+    u32 prgRomSize;
+    u32 chrRomSize;
+    //RAM that is lost at power off and RAM kept by a battery
+    u32 prgRamSize;
+    u32 prgNvramSize;
+    u32 chrRamSize;
+    u32 chrNvramSize;
+    //0 horizontal, 1 vertical
+    int mirroring;
+    bool fourScreen;
+    bool battery;
+    bool trainer;
+    //0 NES/Famicom, 1 Vs. System, 2 PlayChoice-10, 3 extended
+    u8 consoleType;
+    //0 NTSC, 1 PAL, 2 multiple regions, 3 Dendy
+    u8 timing;
+    //over PRG and CHR ROM, without header and trainer, as the ROM databases list them
+    u32 crc32;
+    Sha1::Digest sha1;
+
+    //Header fields only, the hashes are left zero
+    static RomInfo parse(const INESHeader &);
 };
 
 class ROM {
    public:
-    std::vector<u8> getChrData() { return chrData; };
-    std::vector<u8> getPrgCode() { return prgCode; };
+    //Maps the file, ROMs opened from the same file share it. getMapper
+    //returns NULL if it can't be read or is cut short.
     void open(std::string);
     void printHeader();
     int getMirroring();
+    //Filled in by open, hashes only once the file checked out
+    const RomInfo &getInfo() { return info; }
+    //PRG and CHR inside the shared image, every mapper holds on to it
+    const Cartridge &getCartridge() { return cartridge; }
     Mapper *getMapper();
 
    private:
-    INESHeader header;
-    std::vector<u8> trainer;
-    std::vector<u8> prgCode;
-    std::vector<u8> chrData;
-    int mirroring;
-    u8 mapperNum;
+    RomInfo info = {};
+    Cartridge cartridge;
 };
 
 };  //namespace MedNES
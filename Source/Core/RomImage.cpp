@@ -0,0 +1,120 @@
+#include "RomImage.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include "Common/Crc32.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace MedNES {
+
+#ifndef _WIN32
+
+//Images still in use by file, a file replaced on disk is a new image
+typedef std::tuple<dev_t, ino_t, off_t, time_t> FileId;
+static std::mutex openImagesMutex;
+static std::map<FileId, std::weak_ptr<const RomImage>> openImages;
+
+std::shared_ptr<const RomImage> RomImage::open(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat info;
+
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    FileId id(info.st_dev, info.st_ino, info.st_size, info.st_mtime);
+    std::lock_guard<std::mutex> lock(openImagesMutex);
+    std::shared_ptr<const RomImage> shared = openImages[id].lock();
+
+    if (shared != nullptr) {
+        close(fd);
+        return shared;
+    }
+
+    void *memory = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    //the mapping stays valid without the descriptor
+    close(fd);
+
+    if (memory == MAP_FAILED) {
+        openImages.erase(id);
+        return nullptr;
+    }
+
+    std::shared_ptr<RomImage> image(new RomImage());
+    image->bytes = static_cast<const u8 *>(memory);
+    image->length = info.st_size;
+    image->mapped = true;
+
+    //forget images nobody holds anymore
+    for (auto it = openImages.begin(); it != openImages.end();) {
+        it = it->second.expired() ? openImages.erase(it) : std::next(it);
+    }
+
+    openImages[id] = image;
+    return image;
+}
+
+RomImage::~RomImage() {
+    if (mapped) {
+        munmap(const_cast<u8 *>(bytes), length);
+    }
+}
+
+#else
+
+//No mapping, every open reads its own copy
+std::shared_ptr<const RomImage> RomImage::open(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    std::vector<u8> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    if (bytes.empty()) {
+        return nullptr;
+    }
+
+    return copy(bytes.data(), bytes.size());
+}
+
+RomImage::~RomImage() {}
+
+#endif
+
+std::shared_ptr<const RomImage> RomImage::copy(const u8 *data, size_t size) {
+    std::shared_ptr<RomImage> image(new RomImage());
+    image->heap.assign(data, data + size);
+    image->bytes = image->heap.data();
+    image->length = size;
+    return image;
+}
+
+Cartridge Cartridge::fromBytes(const std::vector<u8> &prg, const std::vector<u8> &chr, int mirroring) {
+    std::vector<u8> bytes(prg);
+    bytes.insert(bytes.end(), chr.begin(), chr.end());
+
+    Cartridge cartridge;
+    cartridge.image = RomImage::copy(bytes.data(), bytes.size());
+    cartridge.prg = cartridge.image->data();
+    cartridge.prgSize = prg.size();
+    cartridge.chr = chr.empty() ? nullptr : cartridge.image->data() + prg.size();
+    cartridge.chrSize = chr.size();
+    cartridge.mirroring = mirroring;
+    cartridge.crc32 = Crc32::compute(bytes.data(), bytes.size());
+    return cartridge;
+}
+
+}  //namespace MedNES
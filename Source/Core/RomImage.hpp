@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Common/Typedefs.hpp"
+
+namespace MedNES {
+
+//A ROM file mapped read only. Every machine running the same file shares one
+//image, the OS shares its pages between processes, and nothing writes to it.
+class RomImage {
+   public:
+    //Opening a file that's still open elsewhere returns the same image. Null
+    //if the file can't be read.
+    static std::shared_ptr<const RomImage> open(const std::string &path);
+    //An image over a copy of bytes that don't come from a file
+    static std::shared_ptr<const RomImage> copy(const u8 *data, size_t size);
+
+    ~RomImage();
+    RomImage(const RomImage &) = delete;
+    RomImage &operator=(const RomImage &) = delete;
+
+    const u8 *data() const { return bytes; }
+    size_t size() const { return length; }
+
+   private:
+    RomImage() = default;
+
+    const u8 *bytes = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    //the bytes when they aren't mapped
+    std::vector<u8> heap;
+};
+
+//What a board is built from, PRG and CHR ROM inside a shared image. A
+//cartridge without CHR ROM has 8kb of CHR RAM, allocated by every board.
+struct Cartridge {
+    std::shared_ptr<const RomImage> image;
+    const u8 *prg = nullptr;
+    u32 prgSize = 0;
+    const u8 *chr = nullptr;
+    u32 chrSize = 0;
+    int mirroring = 0;
+    //CRC-32 of PRG and CHR ROM, what save states are checked against
+    u32 crc32 = 0;
+
+    //A cartridge over copies of PRG and CHR, empty CHR for CHR RAM
+    static Cartridge fromBytes(const std::vector<u8> &prg, const std::vector<u8> &chr, int mirroring);
+};
+
+};  //namespace MedNES
@@ -0,0 +1,328 @@
+#include "RomLibrary.hpp"
+
+#include <dirent.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "Mapper/Mapper.hpp"
+
+namespace MedNES {
+
+//The index file is an IndexHeader, count IndexRecords and then the paths,
+//plain data written as is like save states. Bump INDEX_VERSION whenever
+//the layout changes, old indexes are then scanned again from scratch.
+static const u32 INDEX_MAGIC = 0x49524E4D;  //"MNRI"
+static const u32 INDEX_VERSION = 1;
+
+struct IndexHeader {
+    u32 magic;
+    u32 version;
+    u32 count;
+    u32 pathBytes;
+};
+
+struct IndexRecord {
+    u64 size;
+    s64 mtime;
+    u32 pathOffset;
+    u32 pathLength;
+    u32 crc32;
+    u32 prgRomSize;
+    u32 chrRomSize;
+    u32 prgRamSize;
+    u32 prgNvramSize;
+    u32 chrRamSize;
+    u32 chrNvramSize;
+    u16 mapper;
+    u8 submapper;
+    u8 consoleType;
+    u8 timing;
+    u8 flags;
+    u8 sha1[20];
+};
+
+static_assert(std::is_trivially_copyable<IndexRecord>::value, "IndexRecord must stay plain data");
+
+enum IndexFlags : u8 {
+    VALID = 1,
+    SUPPORTED = 2,
+    NES20 = 4,
+    BATTERY = 8,
+    TRAINER = 16,
+    FOUR_SCREEN = 32,
+    VERTICAL = 64,
+};
+
+static bool isRom(const std::string &name) {
+    if (name.size() < 4) {
+        return false;
+    }
+
+    std::string extension = name.substr(name.size() - 4);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+    return extension == ".nes";
+}
+
+//Collects the .nes files under root/relative. Directories are visited once
+//each, so links looping back up the tree end.
+static void findRoms(const std::string &root, const std::string &relative, std::set<std::pair<dev_t, ino_t>> &visited,
+                     std::vector<RomEntry> &found) {
+    std::string directory = relative.empty() ? root : root + "/" + relative;
+    DIR *dir = opendir(directory.c_str());
+
+    if (dir == nullptr) {
+        return;
+    }
+
+    while (dirent *item = readdir(dir)) {
+        std::string name = item->d_name;
+
+        if (name[0] == '.') {
+            continue;
+        }
+
+        std::string path = relative.empty() ? name : relative + "/" + name;
+        struct stat info;
+
+        if (stat((root + "/" + path).c_str(), &info) != 0) {
+            continue;
+        }
+
+        if (S_ISDIR(info.st_mode)) {
+            if (visited.insert(std::make_pair(info.st_dev, info.st_ino)).second) {
+                findRoms(root, path, visited, found);
+            }
+        } else if (S_ISREG(info.st_mode) && isRom(name)) {
+            RomEntry entry = {};
+            entry.path = path;
+            entry.size = info.st_size;
+            entry.mtime = info.st_mtime;
+            found.push_back(entry);
+        }
+    }
+
+    closedir(dir);
+}
+
+static void openEntry(const std::string &root, RomEntry &entry) {
+    ROM rom;
+    rom.open(root + "/" + entry.path);
+    Mapper *mapper = rom.getMapper();
+
+    entry.valid = rom.getCartridge().image != nullptr;
+    entry.supported = mapper != NULL;
+    entry.info = entry.valid ? rom.getInfo() : RomInfo();
+    delete mapper;
+}
+
+RomScanStats RomLibrary::scan(const std::string &root, int threads) {
+    auto start = std::chrono::steady_clock::now();
+    RomScanStats stats = {};
+
+    std::vector<RomEntry> found;
+    std::set<std::pair<dev_t, ino_t>> visited;
+    struct stat rootInfo;
+
+    if (stat(root.c_str(), &rootInfo) == 0) {
+        visited.insert(std::make_pair(rootInfo.st_dev, rootInfo.st_ino));
+    }
+
+    findRoms(root, "", visited, found);
+    std::sort(found.begin(), found.end(), [](const RomEntry &a, const RomEntry &b) { return a.path < b.path; });
+
+    std::map<std::string, const RomEntry *> known;
+
+    for (const RomEntry &entry : entries) {
+        known[entry.path] = &entry;
+    }
+
+    //files that didn't change keep their entry, the rest are opened
+    std::vector<RomEntry *> changed;
+    u32 kept = 0;
+
+    for (RomEntry &entry : found) {
+        auto it = known.find(entry.path);
+
+        if (it == known.end()) {
+            changed.push_back(&entry);
+            continue;
+        }
+
+        kept++;
+
+        if (it->second->size == entry.size && it->second->mtime == entry.mtime) {
+            entry = *it->second;
+            stats.reused++;
+        } else {
+            changed.push_back(&entry);
+        }
+    }
+
+    if (threads <= 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    threads = std::min<size_t>(threads, std::max<size_t>(1, changed.size()));
+    std::atomic<size_t> next(0);
+
+    auto worker = [&]() {
+        for (size_t i = next++; i < changed.size(); i = next++) {
+            openEntry(root, *changed[i]);
+        }
+    };
+
+    std::vector<std::thread> pool;
+
+    for (int i = 1; i < threads; i++) {
+        pool.emplace_back(worker);
+    }
+
+    worker();
+
+    for (auto &thread : pool) {
+        thread.join();
+    }
+
+    stats.files = found.size();
+    stats.opened = changed.size();
+    stats.removed = entries.size() - kept;
+    entries.swap(found);
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return stats;
+}
+
+bool RomLibrary::save(const std::string &indexPath) const {
+    IndexHeader header = {INDEX_MAGIC, INDEX_VERSION, (u32)entries.size(), 0};
+    std::vector<IndexRecord> records(entries.size());
+    std::string paths;
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        const RomEntry &entry = entries[i];
+        const RomInfo &info = entry.info;
+        IndexRecord &record = records[i];
+        //padding included, so equal libraries write equal files
+        memset(&record, 0, sizeof(record));
+
+        record.size = entry.size;
+        record.mtime = entry.mtime;
+        record.pathOffset = paths.size();
+        record.pathLength = entry.path.size();
+        record.crc32 = info.crc32;
+        record.prgRomSize = info.prgRomSize;
+        record.chrRomSize = info.chrRomSize;
+        record.prgRamSize = info.prgRamSize;
+        record.prgNvramSize = info.prgNvramSize;
+        record.chrRamSize = info.chrRamSize;
+        record.chrNvramSize = info.chrNvramSize;
+        record.mapper = info.mapper;
+        record.submapper = info.submapper;
+        record.consoleType = info.consoleType;
+        record.timing = info.timing;
+        record.flags = (entry.valid ? VALID : 0) | (entry.supported ? SUPPORTED : 0) | (info.nes20 ? NES20 : 0) |
+                       (info.battery ? BATTERY : 0) | (info.trainer ? TRAINER : 0) |
+                       (info.fourScreen ? FOUR_SCREEN : 0) | (info.mirroring ? VERTICAL : 0);
+        memcpy(record.sha1, info.sha1.data(), sizeof(record.sha1));
+        paths += entry.path;
+    }
+
+    header.pathBytes = paths.size();
+
+    //written next to it and moved over, readers never see half an index
+    std::string temporary = indexPath + ".tmp";
+
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(IndexRecord));
+    out.write(paths.data(), paths.size());
+    out.close();
+
+    if (!out) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    //rename doesn't replace files everywhere
+    if (std::rename(temporary.c_str(), indexPath.c_str()) != 0) {
+        std::remove(indexPath.c_str());
+
+        if (std::rename(temporary.c_str(), indexPath.c_str()) != 0) {
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool RomLibrary::load(const std::string &indexPath) {
+    std::ifstream in(indexPath, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    IndexHeader header;
+
+    if (bytes.size() < sizeof(header)) {
+        return false;
+    }
+
+    memcpy(&header, bytes.data(), sizeof(header));
+
+    if (header.magic != INDEX_MAGIC || header.version != INDEX_VERSION ||
+        bytes.size() != sizeof(header) + (u64)header.count * sizeof(IndexRecord) + header.pathBytes) {
+        return false;
+    }
+
+    const char *paths = bytes.data() + sizeof(header) + header.count * sizeof(IndexRecord);
+    std::vector<RomEntry> loaded(header.count);
+
+    for (u32 i = 0; i < header.count; i++) {
+        IndexRecord record;
+        memcpy(&record, bytes.data() + sizeof(header) + i * sizeof(IndexRecord), sizeof(record));
+
+        if ((u64)record.pathOffset + record.pathLength > header.pathBytes) {
+            return false;
+        }
+
+        RomEntry &entry = loaded[i];
+        RomInfo &info = entry.info;
+        entry.path.assign(paths + record.pathOffset, record.pathLength);
+        entry.size = record.size;
+        entry.mtime = record.mtime;
+        entry.valid = record.flags & VALID;
+        entry.supported = record.flags & SUPPORTED;
+        info.nes20 = record.flags & NES20;
+        info.battery = record.flags & BATTERY;
+        info.trainer = record.flags & TRAINER;
+        info.fourScreen = record.flags & FOUR_SCREEN;
+        info.mirroring = record.flags & VERTICAL ? 1 : 0;
+        info.mapper = record.mapper;
+        info.submapper = record.submapper;
+        info.prgRomSize = record.prgRomSize;
+        info.chrRomSize = record.chrRomSize;
+        info.prgRamSize = record.prgRamSize;
+        info.prgNvramSize = record.prgNvramSize;
+        info.chrRamSize = record.chrRamSize;
+        info.chrNvramSize = record.chrNvramSize;
+        info.consoleType = record.consoleType;
+        info.timing = record.timing;
+        info.crc32 = record.crc32;
+        memcpy(info.sha1.data(), record.sha1, sizeof(record.sha1));
+    }
+
+    entries.swap(loaded);
+    return true;
+}
+
+}  //namespace MedNES
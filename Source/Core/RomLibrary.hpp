@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Common/Typedefs.hpp"
+#include "ROM.hpp"
+
+namespace MedNES {
+
+//One .nes file of a library
+struct RomEntry {
+    //relative to the library root, with / between directories
+    std::string path;
+    u64 size;
+    s64 mtime;
+    //an iNES file that isn't cut short and holds whole banks, info is
+    //only filled in then
+    bool valid;
+    //ROM::getMapper has a board for it
+    bool supported;
+    RomInfo info;
+};
+
+struct RomScanStats {
+    u32 files;
+    //unchanged since the index was written, not opened again
+    u32 reused;
+    u32 opened;
+    //in the index but gone from disk
+    u32 removed;
+    double seconds;
+};
+
+//Every ROM under a directory with its header info and hashes. A scan opens
+//files on all cores and keeps entries whose size and mtime didn't change,
+//the index file saves a scan so game lists start without opening any ROM.
+class RomLibrary {
+   public:
+    //Replaces the entries with the index file's, false if it can't be read
+    //or was written by another version
+    bool load(const std::string &indexPath);
+    bool save(const std::string &indexPath) const;
+
+    //Brings the entries up to date with the .nes files under root, hidden
+    //files and directories left out. 0 threads is one per core.
+    RomScanStats scan(const std::string &root, int threads = 0);
+
+    //Sorted by path
+    const std::vector<RomEntry> &getEntries() const { return entries; }
+
+   private:
+    std::vector<RomEntry> entries;
+};
+
+};  //namespace MedNES
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <type_traits>
+
+#include "Common/Typedefs.hpp"
+#include "Controller.hpp"
+#include "Mapper/Mapper.hpp"
+#include "PPU.hpp"
+#include "Scheduler.hpp"
+
+namespace MedNES {
+
+struct CPUState {
+    SchedulerState scheduler;
+    u64 instructions;
+    u16 programCounter;
+    u8 accumulator;
+    u8 xRegister;
+    u8 yRegister;
+    u8 stackPointer;
+    u8 statusRegister;
+    u8 ram[2048];
+};
+
+//Snapshot of the whole machine. Every section has a fixed size and offset, so
+//a blob can be written as is, mapped back from a file and loaded by copying.
+//Bump VERSION whenever the layout of any section changes.
+struct SaveState {
+    static const u32 MAGIC = 0x53534E4D;  //"MNSS"
+    static const u32 VERSION = 4;
+
+    u32 magic;
+    u32 version;
+    u32 size;
+    u32 reserved;
+
+    CPUState cpu;
+    PPUState ppu;
+    ControllerState controller;
+    MapperState mapper;
+};
+
+static_assert(std::is_trivially_copyable<SaveState>::value, "SaveState must stay plain data");
+
+};  //namespace MedNES
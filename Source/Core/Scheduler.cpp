@@ -0,0 +1,73 @@
+#include "Scheduler.hpp"
+
+namespace MedNES {
+
+Scheduler::Scheduler() {
+    for (int i = 0; i < EVENT_COUNT; i++) {
+        deadlines[i] = NEVER;
+    }
+}
+
+void Scheduler::schedule(Event event, u64 at) {
+    deadlines[event] = at;
+    updateNext();
+}
+
+void Scheduler::cancel(Event event) {
+    deadlines[event] = NEVER;
+    updateNext();
+}
+
+u64 Scheduler::deadline(Event event) const {
+    return deadlines[event];
+}
+
+bool Scheduler::popDue(Event &event) {
+    if (clock < next) {
+        return false;
+    }
+
+    int earliest = 0;
+
+    for (int i = 1; i < EVENT_COUNT; i++) {
+        if (deadlines[i] < deadlines[earliest]) {
+            earliest = i;
+        }
+    }
+
+    event = (Event)earliest;
+    deadlines[earliest] = NEVER;
+    updateNext();
+
+    return true;
+}
+
+void Scheduler::saveState(SchedulerState &state) const {
+    state.clock = clock;
+
+    for (int i = 0; i < EVENT_COUNT; i++) {
+        state.deadlines[i] = deadlines[i];
+    }
+}
+
+void Scheduler::loadState(const SchedulerState &state) {
+    clock = state.clock;
+
+    for (int i = 0; i < EVENT_COUNT; i++) {
+        deadlines[i] = state.deadlines[i];
+    }
+
+    updateNext();
+}
+
+void Scheduler::updateNext() {
+    next = NEVER;
+
+    for (int i = 0; i < EVENT_COUNT; i++) {
+        if (deadlines[i] < next) {
+            next = deadlines[i];
+        }
+    }
+}
+
+}  //namespace MedNES
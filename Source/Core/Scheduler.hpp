@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Common/Typedefs.hpp"
+
+namespace MedNES {
+
+struct SchedulerState;
+
+//Master clock and the timed events the CPU runs towards. There are only a
+//handful of event kinds, so the queue is a fixed slot per kind plus the
+//earliest deadline cached for the instruction loop.
+class Scheduler {
+   public:
+    enum Event {
+        FRAME_START,
+        VBLANK_START,
+        VBLANK_END,
+        NMI,
+        APU_FRAME_STEP,
+        MAPPER_IRQ,
+        EVENT_COUNT
+    };
+
+    static const u64 NEVER = ~0ULL;
+
+    Scheduler();
+
+    inline u64 now() const { return clock; }
+    inline void advance(u64 cycles) { clock += cycles; }
+    inline u64 nextDeadline() const { return next; }
+    inline bool isDue() const { return clock >= next; }
+
+    void schedule(Event, u64);
+    void cancel(Event);
+    u64 deadline(Event) const;
+
+    //Take the earliest event that is due, false if none is
+    bool popDue(Event &);
+
+    void saveState(SchedulerState &) const;
+    void loadState(const SchedulerState &);
+
+   private:
+    friend class Jit;
+
+    u64 clock = 0;
+    u64 next = NEVER;
+    u64 deadlines[EVENT_COUNT];
+
+    void updateNext();
+};
+
+struct SchedulerState {
+    u64 clock;
+    u64 deadlines[Scheduler::EVENT_COUNT];
+};
+
+};  //namespace MedNES
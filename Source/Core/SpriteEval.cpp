@@ -0,0 +1,140 @@
+#include "SpriteEval.hpp"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace MedNES {
+
+u64 spritesOnLineScalar(const u8 *oam, int line, int height) {
+    u64 mask = 0;
+
+    for (int n = 0; n < 64; n++) {
+        int y = oam[n * 4];
+
+        if (line >= y && line < y + height) {
+            mask |= (u64)1 << n;
+        }
+    }
+
+    return mask;
+}
+
+//Unsigned byte compares are done as signed ones on values with the top bit
+//flipped. A sprite is on the line when y <= line and (line - y) mod 256 is
+//below the height, the first test drops the sprites that wrapped around.
+
+#if defined(__AVX2__)
+
+u64 spritesOnLine(const u8 *oam, int line, int height) {
+    const __m256i yMask = _mm256_set1_epi32(0xFF);
+    const __m256i bias = _mm256_set1_epi8((char)0x80);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    const __m256i lineVec = _mm256_set1_epi8((char)line);
+    const __m256i lineBiased = _mm256_xor_si256(lineVec, bias);
+    const __m256i heightBiased = _mm256_xor_si256(_mm256_set1_epi8((char)height), bias);
+    u64 mask = 0;
+
+    for (int i = 0; i < 2; i++) {
+        const __m256i *src = (const __m256i *)&oam[i * 128];
+
+        //Y bytes of 32 sprites, the packs work per 128-bit lane so the dwords
+        //come out shuffled and are put back in order
+        __m256i a = _mm256_and_si256(_mm256_loadu_si256(src), yMask);
+        __m256i b = _mm256_and_si256(_mm256_loadu_si256(src + 1), yMask);
+        __m256i c = _mm256_and_si256(_mm256_loadu_si256(src + 2), yMask);
+        __m256i d = _mm256_and_si256(_mm256_loadu_si256(src + 3), yMask);
+        __m256i y = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+        y = _mm256_permutevar8x32_epi32(y, order);
+
+        __m256i below = _mm256_cmpgt_epi8(_mm256_xor_si256(y, bias), lineBiased);
+        __m256i offset = _mm256_xor_si256(_mm256_sub_epi8(lineVec, y), bias);
+        __m256i inRange = _mm256_andnot_si256(below, _mm256_cmpgt_epi8(heightBiased, offset));
+        mask |= (u64)(u32)_mm256_movemask_epi8(inRange) << (i * 32);
+    }
+
+    return mask;
+}
+
+const char *spriteEvalName() {
+    return "avx2";
+}
+
+#elif defined(__SSE2__)
+
+u64 spritesOnLine(const u8 *oam, int line, int height) {
+    const __m128i yMask = _mm_set1_epi32(0xFF);
+    const __m128i bias = _mm_set1_epi8((char)0x80);
+    const __m128i lineVec = _mm_set1_epi8((char)line);
+    const __m128i lineBiased = _mm_xor_si128(lineVec, bias);
+    const __m128i heightBiased = _mm_xor_si128(_mm_set1_epi8((char)height), bias);
+    u64 mask = 0;
+
+    for (int i = 0; i < 4; i++) {
+        const __m128i *src = (const __m128i *)&oam[i * 64];
+
+        //Y bytes of 16 sprites
+        __m128i a = _mm_and_si128(_mm_loadu_si128(src), yMask);
+        __m128i b = _mm_and_si128(_mm_loadu_si128(src + 1), yMask);
+        __m128i c = _mm_and_si128(_mm_loadu_si128(src + 2), yMask);
+        __m128i d = _mm_and_si128(_mm_loadu_si128(src + 3), yMask);
+        __m128i y = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+
+        __m128i below = _mm_cmpgt_epi8(_mm_xor_si128(y, bias), lineBiased);
+        __m128i offset = _mm_xor_si128(_mm_sub_epi8(lineVec, y), bias);
+        __m128i inRange = _mm_andnot_si128(below, _mm_cmpgt_epi8(heightBiased, offset));
+        mask |= (u64)(u16)_mm_movemask_epi8(inRange) << (i * 16);
+    }
+
+    return mask;
+}
+
+const char *spriteEvalName() {
+    return "sse2";
+}
+
+#elif defined(__ARM_NEON)
+
+u64 spritesOnLine(const u8 *oam, int line, int height) {
+    static const u8 weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t bitWeights = vld1q_u8(weights);
+    const uint8x16_t lineVec = vdupq_n_u8(line);
+    const uint8x16_t heightVec = vdupq_n_u8(height);
+    u64 mask = 0;
+
+    for (int i = 0; i < 4; i++) {
+        //Y bytes of 16 sprites
+        uint8x16_t y = vld4q_u8(&oam[i * 64]).val[0];
+        uint8x16_t inRange = vandq_u8(vcleq_u8(y, lineVec), vcltq_u8(vsubq_u8(lineVec, y), heightVec));
+
+        //one bit per sprite, the low and high 8 end up in lanes 0 and 1
+        uint8x16_t bits = vandq_u8(inRange, bitWeights);
+        uint8x8_t sum = vpadd_u8(vget_low_u8(bits), vget_high_u8(bits));
+        sum = vpadd_u8(sum, sum);
+        sum = vpadd_u8(sum, sum);
+        u64 group = vget_lane_u8(sum, 0) | (vget_lane_u8(sum, 1) << 8);
+        mask |= group << (i * 16);
+    }
+
+    return mask;
+}
+
+const char *spriteEvalName() {
+    return "neon";
+}
+
+#else
+
+u64 spritesOnLine(const u8 *oam, int line, int height) {
+    return spritesOnLineScalar(oam, line, height);
+}
+
+const char *spriteEvalName() {
+    return "scalar";
+}
+
+#endif
+
+}  //namespace MedNES
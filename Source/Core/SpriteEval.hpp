@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Common/Typedefs.hpp"
+
+namespace MedNES {
+
+//Bit n is set when sprite n of the raw 256 byte OAM covers the line, for
+//sprites height lines tall. Only the Y bytes are looked at.
+u64 spritesOnLine(const u8 *oam, int line, int height);
+
+//One sprite at a time, what the SIMD paths have to match
+u64 spritesOnLineScalar(const u8 *oam, int line, int height);
+
+//The instruction set spritesOnLine was built for
+const char *spriteEvalName();
+
+};  //namespace MedNES
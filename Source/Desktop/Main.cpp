@@ -1,19 +1,60 @@
 #include <SDL.h>
 
+#include <atomic>
 #include <chrono>
+#include <fstream>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <thread>
 
 #include "../Core/6502.hpp"
+#include "../Core/Common/FramePacing.hpp"
+#include "../Core/Common/TripleBuffer.hpp"
 #include "../Core/Controller.hpp"
 #include "../Core/Mapper/Mapper.hpp"
 #include "../Core/PPU.hpp"
 #include "../Core/ROM.hpp"
 
+//F5 and F8, done by the emulation thread between frames
+enum StateRequest {
+    NO_REQUEST,
+    SAVE_STATE,
+    LOAD_STATE
+};
+
+//Buttons are set here and read by the emulation thread once a frame
+static void setButton(std::atomic<MedNES::u8> &buttons, MedNES::Controller::Button button, bool pressed) {
+    if (pressed) {
+        buttons |= 1 << button;
+    } else {
+        buttons &= ~(1 << button);
+    }
+}
+
+//The state is plain data, it is written and read back as is
+static void saveStateFile(const std::string &path, MedNES::CPU6502 &cpu, MedNES::SaveState &state) {
+    cpu.saveState(state);
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char *>(&state), sizeof(state));
+    std::cout << (out ? "Saved state to " : "Could not write ") << path << std::endl;
+}
+
+static void loadStateFile(const std::string &path, MedNES::CPU6502 &cpu, MedNES::SaveState &state) {
+    std::ifstream in(path, std::ios::binary);
+
+    if (!in.read(reinterpret_cast<char *>(&state), sizeof(state)) || !cpu.loadState(state)) {
+        std::cout << "Could not load state from " << path << std::endl;
+    }
+}
+
 int main(int argc, char **argv) {
     std::string romPath = "";
     std::string COMMAND_LINE_ERROR_MESSAGE = "Use -insert <path/to/rom> to start playing.";
     bool fullscreen = false;
+    bool blockCache = false;
+    bool jit = false;
+    bool idleSkip = false;
 
     if (argc < 2) {
         std::cout << COMMAND_LINE_ERROR_MESSAGE << std::endl;
@@ -29,6 +70,18 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+    for (int i = 3; i < argc; i++) {
+        std::string flag = argv[i];
+
+        if (flag == "-blockcache") {
+            blockCache = true;
+        } else if (flag == "-jit") {
+            jit = true;
+        } else if (flag == "-idleskip") {
+            idleSkip = true;
+        }
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER) < 0) {
         std::cout << "SDL could not initialize." << SDL_GetError() << std::endl;
     }
@@ -43,19 +96,27 @@ int main(int argc, char **argv) {
         }
     }
 
-    //TODO: Refactor me
-    std::map<int, int> map;
-    map.insert(std::pair<int, int>(SDL_CONTROLLER_BUTTON_A, SDLK_a));
-    map.insert(std::pair<int, int>(SDL_CONTROLLER_BUTTON_B, SDLK_b));
-    map.insert(std::pair<int, int>(SDL_CONTROLLER_BUTTON_START, SDLK_RETURN));
-    map.insert(std::pair<int, int>(SDL_CONTROLLER_BUTTON_DPAD_UP, SDLK_UP));
-    map.insert(std::pair<int, int>(SDL_CONTROLLER_BUTTON_DPAD_DOWN, SDLK_DOWN));
-    map.insert(std::pair<int, int>(SDL_CONTROLLER_BUTTON_DPAD_LEFT, SDLK_LEFT));
-    map.insert(std::pair<int, int>(SDL_CONTROLLER_BUTTON_DPAD_RIGHT, SDLK_RIGHT));
+    std::map<int, MedNES::Controller::Button> buttonMap;
+    buttonMap.insert(std::make_pair(SDL_CONTROLLER_BUTTON_A, MedNES::Controller::A));
+    buttonMap.insert(std::make_pair(SDL_CONTROLLER_BUTTON_B, MedNES::Controller::B));
+    buttonMap.insert(std::make_pair(SDL_CONTROLLER_BUTTON_START, MedNES::Controller::START));
+    buttonMap.insert(std::make_pair(SDL_CONTROLLER_BUTTON_DPAD_UP, MedNES::Controller::UP));
+    buttonMap.insert(std::make_pair(SDL_CONTROLLER_BUTTON_DPAD_DOWN, MedNES::Controller::DOWN));
+    buttonMap.insert(std::make_pair(SDL_CONTROLLER_BUTTON_DPAD_LEFT, MedNES::Controller::LEFT));
+    buttonMap.insert(std::make_pair(SDL_CONTROLLER_BUTTON_DPAD_RIGHT, MedNES::Controller::RIGHT));
+
+    std::map<SDL_Keycode, MedNES::Controller::Button> keyMap;
+    keyMap.insert(std::make_pair(SDLK_a, MedNES::Controller::A));
+    keyMap.insert(std::make_pair(SDLK_b, MedNES::Controller::B));
+    keyMap.insert(std::make_pair(SDLK_SPACE, MedNES::Controller::SELECT));
+    keyMap.insert(std::make_pair(SDLK_RETURN, MedNES::Controller::START));
+    keyMap.insert(std::make_pair(SDLK_UP, MedNES::Controller::UP));
+    keyMap.insert(std::make_pair(SDLK_DOWN, MedNES::Controller::DOWN));
+    keyMap.insert(std::make_pair(SDLK_LEFT, MedNES::Controller::LEFT));
+    keyMap.insert(std::make_pair(SDLK_RIGHT, MedNES::Controller::RIGHT));
 
     SDL_Window *window;
     std::string window_title = "MedNES";
-    bool headlessMode = false;
 
     window = SDL_CreateWindow(
         window_title.c_str(),     // window title
@@ -75,11 +136,8 @@ int main(int argc, char **argv) {
         SDL_SetWindowFullscreen(window, SDL_WINDOW_FULLSCREEN);
     }
 
-    bool is_running = true;
-
-    SDL_Event event;
     // We create a renderer with hardware acceleration, we also present according with the vertical sync refresh.
-    SDL_Renderer *s = SDL_CreateRenderer(window, 0, SDL_RENDERER_ACCELERATED | ((headlessMode) ? 0 : SDL_RENDERER_PRESENTVSYNC));
+    SDL_Renderer *s = SDL_CreateRenderer(window, 0, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
 
     MedNES::ROM rom;
     rom.open(romPath);
@@ -87,71 +145,157 @@ int main(int argc, char **argv) {
     MedNES::Mapper *mapper = rom.getMapper();
 
     if (mapper == NULL) {
-        std::cout << "Unknown mapper.";
+        std::cout << "Could not read ROM or unknown mapper.";
         return 1;
     }
 
     auto ppu = MedNES::PPU(mapper);
     MedNES::Controller controller;
-    auto cpu = MedNES::CPU6502(mapper, &ppu, &controller);
+    MedNES::CPU6502 cpu(mapper, &ppu, &controller);
+    cpu.setBlockCache(blockCache);
+
+    if (jit && !cpu.setJit(true)) {
+        std::cout << "JIT not available, using the interpreter." << std::endl;
+    }
+
+    cpu.setIdleLoopSkip(idleSkip);
     cpu.reset();
-    SDL_Texture *texture = SDL_CreateTexture(s, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, 256, 240);
-
-    //For perf
-    int nmiCounter = 0;
-    float duration = 0;
-    auto t1 = std::chrono::high_resolution_clock::now();
-
-    while (is_running) {
-        cpu.step();
-
-        if (ppu.generateFrame) {
-            //Poll controller
-            while (SDL_PollEvent(&event)) {
-                switch (event.type) {
-                    case SDL_CONTROLLERBUTTONDOWN:
-                        controller.setButtonPressed(map.find(event.cbutton.button)->second, true);
-                        break;
-                    case SDL_CONTROLLERBUTTONUP:
-                        controller.setButtonPressed(map.find(event.cbutton.button)->second, false);
-                        break;
-                    case SDL_KEYDOWN:
-                        controller.setButtonPressed(event.key.keysym.sym, true);
-                        break;
-                    case SDL_KEYUP:
-                        controller.setButtonPressed(event.key.keysym.sym, false);
-                        break;
-                    case SDL_QUIT:
-                        is_running = false;
-                        break;
-                    default:
-                        break;
-                }
+    std::string statePath = romPath + ".state";
+    std::unique_ptr<MedNES::SaveState> state(new MedNES::SaveState());
+    SDL_Texture *texture = SDL_CreateTexture(s, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, 256, 240);
+
+    //Emulation runs on its own thread at the NES frame rate and publishes the
+    //frames it draws, this one shows the newest at every vsync. Input and the
+    //hotkeys cross over through atomics and are applied between frames.
+    MedNES::TripleBuffer<uint32_t> frames(256 * 240);
+    std::atomic<bool> running(true);
+    std::atomic<MedNES::u8> buttons(0);
+    std::atomic<bool> fastForward(false);
+    std::atomic<int> stateRequest(NO_REQUEST);
+
+    std::thread emulation([&]() {
+        const std::chrono::nanoseconds framePeriod(
+            MedNES::DOTS_PER_SCANLINE * MedNES::SCANLINES_PER_FRAME * MedNES::PPU_CLOCK_DIVIDER * 1000000000 / MedNES::MASTER_CLOCK_HZ);
+        auto deadline = std::chrono::steady_clock::now();
+
+        ppu.setFrameTarget({frames.back(), 256 * sizeof(uint32_t), MedNES::PixelFormat::ARGB8888});
+
+        while (running) {
+            controller.setButtons(buttons);
+            //fast forward draws one frame in 4 and only drawn frames are paced
+            ppu.setDrawInterval(fastForward ? 4 : 1);
+
+            switch (stateRequest.exchange(NO_REQUEST)) {
+                case SAVE_STATE:
+                    saveStateFile(statePath, cpu, *state);
+                    break;
+                case LOAD_STATE:
+                    loadStateFile(statePath, cpu, *state);
+                    break;
+                default:
+                    break;
             }
-            //Measure fps
-            nmiCounter++;
-            auto t2 = std::chrono::high_resolution_clock::now();
-            duration += std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
-            t1 = std::chrono::high_resolution_clock::now();
-
-            if (nmiCounter == 10) {
-                float avgFps = 1000 / (duration / nmiCounter);
-                std::string fpsTitle = window_title + " (FPS: " + std::to_string((int)avgFps) + ")";
-                SDL_SetWindowTitle(window, fpsTitle.c_str());
-                nmiCounter = 0;
-                duration = 0;
+
+            while (!ppu.generateFrame) {
+                cpu.run();
             }
 
-            //Draw frame
             ppu.generateFrame = false;
-            SDL_RenderSetScale(s, 2, 2);
-            SDL_UpdateTexture(texture, NULL, ppu.buffer, 256 * sizeof(Uint32));
-            SDL_RenderClear(s);
-            SDL_RenderCopy(s, texture, NULL, NULL);
-            SDL_RenderPresent(s);
+
+            if (!ppu.isFrameDrawn()) {
+                continue;
+            }
+
+            frames.publish();
+            ppu.setFrameTarget({frames.back(), 256 * sizeof(uint32_t), MedNES::PixelFormat::ARGB8888});
+
+            //after a stall carry on from now instead of catching up
+            deadline += framePeriod;
+            auto now = std::chrono::steady_clock::now();
+
+            if (deadline < now - framePeriod) {
+                deadline = now;
+            }
+
+            std::this_thread::sleep_until(deadline);
+        }
+    });
+
+    MedNES::FramePacing pacing;
+    MedNES::u64 shownBefore = 0;
+    auto titleTime = std::chrono::steady_clock::now();
+    SDL_Event event;
+
+    while (running) {
+        //Poll controller
+        while (SDL_PollEvent(&event)) {
+            switch (event.type) {
+                case SDL_CONTROLLERBUTTONDOWN:
+                case SDL_CONTROLLERBUTTONUP: {
+                    auto button = buttonMap.find(event.cbutton.button);
+
+                    if (button != buttonMap.end()) {
+                        setButton(buttons, button->second, event.type == SDL_CONTROLLERBUTTONDOWN);
+                    }
+                    break;
+                }
+                case SDL_KEYDOWN:
+                case SDL_KEYUP: {
+                    if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F5) {
+                        stateRequest = SAVE_STATE;
+                    } else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F8) {
+                        stateRequest = LOAD_STATE;
+                    } else if (event.key.keysym.sym == SDLK_TAB) {
+                        fastForward = event.type == SDL_KEYDOWN;
+                    }
+
+                    auto key = keyMap.find(event.key.keysym.sym);
+
+                    if (key != keyMap.end()) {
+                        setButton(buttons, key->second, event.type == SDL_KEYDOWN);
+                    }
+                    break;
+                }
+                case SDL_QUIT:
+                    running = false;
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        //Draw the newest frame, the last one again if there is none
+        bool newFrame = frames.acquire();
+
+        if (newFrame) {
+            SDL_UpdateTexture(texture, NULL, frames.front(), 256 * sizeof(Uint32));
+        }
+
+        SDL_RenderSetScale(s, 2, 2);
+        SDL_RenderClear(s);
+        SDL_RenderCopy(s, texture, NULL, NULL);
+        SDL_RenderPresent(s);
+        pacing.present(newFrame);
+
+        //Frame pacing in the title, once a second
+        auto now = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(now - titleTime).count();
+
+        if (seconds >= 1) {
+            MedNES::FramePacingStats stats = pacing.stats();
+            MedNES::u64 shown = stats.presented - stats.repeated;
+            char title[160];
+            snprintf(title, sizeof(title), "%s (FPS: %d, frame time p50 %.1f ms p99 %.1f ms, dropped %llu, repeated %llu)",
+                     window_title.c_str(), (int)((shown - shownBefore) / seconds), stats.p50, stats.p99,
+                     (unsigned long long)frames.getDropped(), (unsigned long long)stats.repeated);
+            SDL_SetWindowTitle(window, title);
+            shownBefore = shown;
+            titleTime = now;
         }
     }
 
+    emulation.join();
+
     SDL_Delay(3000);
 
     SDL_DestroyWindow(window);
@@ -0,0 +1,107 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <iostream>
+#include <string>
+
+#include "../Core/RomLibrary.hpp"
+
+//ROM library scanner: indexes every .nes file under a directory with its
+//header info and hashes, reopening only files that changed since the last run
+
+static const int MAX_THREADS = 256;
+
+static const char *USAGE =
+    "Usage: mednes-scan <directory> [-index file] [-threads N] [-list]\n"
+    "  -index   defaults to mednes.index in the directory\n"
+    "  -threads defaults to one per core\n"
+    "  -list    print every ROM: CRC32, SHA-1, mapper, supported, path\n";
+
+//A whole number from min to max, false for anything else
+static bool parseNumber(const char *text, long min, long max, int &value) {
+    char *end;
+    errno = 0;
+    long number = strtol(text, &end, 10);
+
+    if (end == text || *end != '\0' || errno == ERANGE || number < min || number > max) {
+        return false;
+    }
+
+    value = number;
+    return true;
+}
+
+int main(int argc, char **argv) {
+    std::string root = "";
+    std::string indexPath = "";
+    int threads = 0;
+    bool list = false;
+
+    if (argc < 2) {
+        std::cout << USAGE;
+        return 1;
+    }
+
+    root = argv[1];
+
+    for (int i = 2; i < argc; i++) {
+        std::string flag = argv[i];
+
+        if (flag == "-index" && i + 1 < argc) {
+            indexPath = argv[++i];
+        } else if (flag == "-threads" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], 1, MAX_THREADS, threads)) {
+                std::cout << "-threads needs a number from 1 to " << MAX_THREADS << ".\n"
+                          << USAGE;
+                return 1;
+            }
+        } else if (flag == "-list") {
+            list = true;
+        } else {
+            std::cout << "Unkown option '" << flag << "'.\n"
+                      << USAGE;
+            return 1;
+        }
+    }
+
+    if (indexPath.empty()) {
+        indexPath = root + "/mednes.index";
+    }
+
+    //a missing or outdated index just means every file is opened
+    MedNES::RomLibrary library;
+    library.load(indexPath);
+    MedNES::RomScanStats stats = library.scan(root, threads);
+
+    if (!library.save(indexPath)) {
+        std::cout << "Could not write index '" << indexPath << "'." << std::endl;
+        return 1;
+    }
+
+    int unsupported = 0;
+    int invalid = 0;
+
+    for (const MedNES::RomEntry &entry : library.getEntries()) {
+        invalid += !entry.valid;
+        unsupported += entry.valid && !entry.supported;
+
+        if (list) {
+            std::string sha1;
+
+            for (MedNES::u8 byte : entry.info.sha1) {
+                char hex[3];
+                snprintf(hex, sizeof(hex), "%02x", byte);
+                sha1 += hex;
+            }
+
+            printf("%08X\t%s\t%d\t%s\t%s\n", entry.info.crc32, sha1.c_str(), entry.info.mapper,
+                   !entry.valid ? "invalid" : (entry.supported ? "yes" : "no"), entry.path.c_str());
+        }
+    }
+
+    printf("%u ROMs in %.3f s: %u unchanged, %u opened, %u removed, %d unsupported, %d invalid\n", stats.files,
+           stats.seconds, stats.reused, stats.opened, stats.removed, unsupported, invalid);
+
+    return 0;
+}
@@ -77,27 +77,19 @@ extern "C" bool EMSCRIPTEN_KEEPALIVE init(const char* charRom) {
     return true;
 }
 
+// charPixels is the 256x240 RGBA ImageData the page shows, the PPU draws into it in place
 extern "C" void EMSCRIPTEN_KEEPALIVE render(unsigned char* charPixels) {
     if (objRom == NULL) { 
         return;
     }
 
+    objPpu->setFrameTarget({ charPixels, 256 * 4, MedNES::PixelFormat::ABGR8888 });
+
     while (objPpu->generateFrame == false) {
-        objCpu->step();
+        objCpu->run();
     }
 
     objPpu->generateFrame = false;
-
-    unsigned char* charPpu = (unsigned char*) (objPpu->buffer);
-
-    for (int intY = 0; intY < 480; intY += 1) {
-        for (int intX = 0; intX < 512; intX += 1) {
-            charPixels[(intY * 512 * 4) + (intX * 4) + 0] = charPpu[((intY / 2) * 256 * 4) + ((intX / 2) * 4) + 2];
-            charPixels[(intY * 512 * 4) + (intX * 4) + 1] = charPpu[((intY / 2) * 256 * 4) + ((intX / 2) * 4) + 1];
-            charPixels[(intY * 512 * 4) + (intX * 4) + 2] = charPpu[((intY / 2) * 256 * 4) + ((intX / 2) * 4) + 0];
-            charPixels[(intY * 512 * 4) + (intX * 4) + 3] = 255;
-        }
-    }
 }
 
 extern "C" void EMSCRIPTEN_KEEPALIVE key(int intState, int intKey) {
@@ -106,28 +98,28 @@ extern "C" void EMSCRIPTEN_KEEPALIVE key(int intState, int intKey) {
     }
 
     if (intKey == 37) {
-        objController->setButtonPressed(SDLK_LEFT, intState);
+        objController->setButtonPressed(MedNES::Controller::LEFT, intState);
         
     } else if (intKey == 38) {
-        objController->setButtonPressed(SDLK_UP, intState);
+        objController->setButtonPressed(MedNES::Controller::UP, intState);
         
     } else if (intKey == 39) {
-        objController->setButtonPressed(SDLK_RIGHT, intState);
+        objController->setButtonPressed(MedNES::Controller::RIGHT, intState);
         
     } else if (intKey == 40) {
-        objController->setButtonPressed(SDLK_DOWN, intState);
+        objController->setButtonPressed(MedNES::Controller::DOWN, intState);
         
     } else if (intKey == 88) {
-        objController->setButtonPressed(SDLK_a, intState);
+        objController->setButtonPressed(MedNES::Controller::A, intState);
         
     } else if (intKey == 67) {
-        objController->setButtonPressed(SDLK_b, intState);
+        objController->setButtonPressed(MedNES::Controller::B, intState);
         
     } else if (intKey == 32) {
-        objController->setButtonPressed(SDLK_SPACE, intState);
+        objController->setButtonPressed(MedNES::Controller::SELECT, intState);
         
     } else if (intKey == 13) {
-        objController->setButtonPressed(SDLK_RETURN, intState);
+        objController->setButtonPressed(MedNES::Controller::START, intState);
         
     }
 }
@@ -6,10 +6,15 @@ source ~/Desktop/emsdk/emsdk_env.sh
 mkdir ./build
 
 emcc -O3 -std=c++14 -I../Core -c -o ./build/6502.o ../Core/6502.cpp
+emcc -O3 -std=c++14 -I../Core -c -o ./build/BlockCache.o ../Core/BlockCache.cpp
+emcc -O3 -std=c++14 -I../Core -c -o ./build/Compositor.o ../Core/Compositor.cpp
 emcc -O3 -std=c++14 -I../Core -c -o ./build/Controller.o ../Core/Controller.cpp
 emcc -O3 -std=c++14 -I../Core -c -o ./build/PPU.o ../Core/PPU.cpp
 emcc -O3 -std=c++14 -I../Core -c -o ./build/RAM.o ../Core/RAM.cpp
 emcc -O3 -std=c++14 -I../Core -c -o ./build/ROM.o ../Core/ROM.cpp
+emcc -O3 -std=c++14 -I../Core -c -o ./build/RomImage.o ../Core/RomImage.cpp
+emcc -O3 -std=c++14 -I../Core -c -o ./build/Scheduler.o ../Core/Scheduler.cpp
+emcc -O3 -std=c++14 -I../Core -c -o ./build/SpriteEval.o ../Core/SpriteEval.cpp
 emcc -O3 -std=c++14 -I../Core -c -o ./build/CNROM.o ../Core/Mapper/CNROM.cpp
 emcc -O3 -std=c++14 -I../Core -c -o ./build/Mapper.o ../Core/Mapper/Mapper.cpp
 emcc -O3 -std=c++14 -I../Core -c -o ./build/NROM.o ../Core/Mapper/NROM.cpp
@@ -1,7 +1,25 @@
 #include "CPUTest.hpp"
+#include "Common/Crc32.hpp"
+#include "Common/FramePacing.hpp"
+#include "Common/TripleBuffer.hpp"
+#include "Mapper/CNROM.hpp"
+#include "Mapper/MMC1.hpp"
+#include "Mapper/NROM.hpp"
+#include "Mapper/UnROM.hpp"
+#include "RomLibrary.hpp"
+#include "SpriteEval.hpp"
+#include <algorithm>
 #include <fstream>
+#include <functional>
 #include <iomanip>
+#include <memory>
 #include <chrono>
+#include <thread>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 //C000  4C F5 C5  JMP $C5F5                       A:00 X:00 Y:00 P:24 SP:FD PPU:  0,  0 CYC:7
 ExecutionState* CPUTest::parseExecutionStateFromLogLine(std::string line) {
@@ -43,7 +61,7 @@ ExecutionState* CPUTest::parseExecutionStateFromLogLine(std::string line) {
     lexerStream.str("");
     
     //cycle
-    for (int i = 90; i < line.length(); i++) {
+    for (size_t i = 90; i < line.length(); i++) {
         lexerStream << line[i];
     }
     
@@ -53,22 +71,22 @@ ExecutionState* CPUTest::parseExecutionStateFromLogLine(std::string line) {
     return expectedState;
 }
 
-void CPUTest::runTest(std::string testROMPath, std::string testLogPath) {
+void CPUTest::runTest(std::string testROMPath, std::string testLogPath, bool blockCache) {
     ROM rom;
-    rom.open(romPath);
+    rom.open(testROMPath);
     rom.printHeader();
     Mapper* mapper = rom.getMapper();
 
     if (mapper == NULL) {
         std::cout << "Unknown mapper.";
-        return 1;
+        return;
     }
 
-    PPU ppu = PPU(mapper);
-    ppu.setMirroring(rom.getMirroring());
+    PPU ppu(mapper);
     Controller controller;
-    CPU6502 cpu = CPU6502(mapper, &ppu, &controller);
+    CPU6502 cpu(mapper, &ppu, &controller);
     cpu.setProgramCounter(0xC000);
+    cpu.setBlockCache(blockCache);
     
     ExecutionState* expectedExecutionState;
     ExecutionState* actualExecutionState;
@@ -83,14 +101,21 @@ void CPUTest::runTest(std::string testROMPath, std::string testLogPath) {
         while (getline(logFile, logLine)) {
             expectedExecutionState = parseExecutionStateFromLogLine(logLine);
             actualExecutionState = cpu.getExecutionState();
+
+            //a block step runs several instructions, skip to where it stopped
+            if (blockCache && actualExecutionState->cycle > expectedExecutionState->cycle) {
+                delete expectedExecutionState;
+                delete actualExecutionState;
+                continue;
+            }
             
-            assert(("Programcounter is incorrect!", actualExecutionState->programCounter == expectedExecutionState->programCounter));
-            assert(("Accumulator is incorrect!", actualExecutionState->accumulator == expectedExecutionState->accumulator));
-            assert(("xRegister is incorrect!", actualExecutionState->xRegister == expectedExecutionState->xRegister));
-            assert(("yRegister is incorrect!", actualExecutionState->yRegister == expectedExecutionState->yRegister));
-            assert(("statusRegister is incorrect!", actualExecutionState->statusRegister == expectedExecutionState->statusRegister));
-            assert(("stackpointer is incorrect!", actualExecutionState->stackPointer == expectedExecutionState->stackPointer));
-            assert(("timing is incorrect", actualExecutionState->cycle == expectedExecutionState->cycle));
+            assert(actualExecutionState->programCounter == expectedExecutionState->programCounter && "Programcounter is incorrect!");
+            assert(actualExecutionState->accumulator == expectedExecutionState->accumulator && "Accumulator is incorrect!");
+            assert(actualExecutionState->xRegister == expectedExecutionState->xRegister && "xRegister is incorrect!");
+            assert(actualExecutionState->yRegister == expectedExecutionState->yRegister && "yRegister is incorrect!");
+            assert(actualExecutionState->statusRegister == expectedExecutionState->statusRegister && "statusRegister is incorrect!");
+            assert(actualExecutionState->stackPointer == expectedExecutionState->stackPointer && "stackpointer is incorrect!");
+            assert(actualExecutionState->cycle == expectedExecutionState->cycle && "timing is incorrect");
             
             cpu.step();
             
@@ -100,9 +125,1103 @@ void CPUTest::runTest(std::string testROMPath, std::string testLogPath) {
         
         auto t2 = std::chrono::high_resolution_clock::now();
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>( t2 - t1 ).count();
-        std::cout << testROMPath << " test PASSED! " << duration << " ms.\n";
+        std::cout << testROMPath << (blockCache ? " (block cache)" : "") << " test PASSED! " << duration << " ms.\n";
         
         logFile.close();
     }
 
 }
+
+//One whole machine on a test ROM, for the tests that run several side by side
+struct TestMachine {
+    ROM rom;
+    std::unique_ptr<Mapper> mapper;
+    std::unique_ptr<PPU> ppu;
+    Controller controller;
+    std::unique_ptr<CPU6502> cpu;
+
+    bool open(const std::string& testROMPath) {
+        rom.open(testROMPath);
+        mapper.reset(rom.getMapper());
+
+        if (mapper == nullptr) {
+            std::cout << "Unknown mapper.";
+            return false;
+        }
+
+        ppu.reset(new PPU(mapper.get()));
+        cpu.reset(new CPU6502(mapper.get(), ppu.get(), &controller));
+        return true;
+    }
+
+    //Runs until the PPU finishes a frame, the buttons left as they are
+    void runFrame() {
+        while (!ppu->generateFrame) {
+            cpu->run();
+        }
+
+        ppu->generateFrame = false;
+    }
+};
+
+//Run a JIT machine and an interpreter machine side by side and compare
+//them every time the JIT machine finishes a block.
+void CPUTest::runJitLockstepTest(std::string testROMPath, u64 cycles) {
+    TestMachine jit, machine;
+
+    if (!jit.open(testROMPath) || !machine.open(testROMPath)) {
+        return;
+    }
+
+    CPU6502& jitCpu = *jit.cpu;
+    CPU6502& cpu = *machine.cpu;
+
+    if (!jitCpu.setJit(true)) {
+        std::cout << testROMPath << " JIT lockstep test SKIPPED, JIT not built in.\n";
+        return;
+    }
+
+#ifdef MEDNES_HAS_JIT
+    //translate every block on its first run
+    jitCpu.getJit().hotThreshold = 1;
+#endif
+
+    jitCpu.setProgramCounter(0xC000);
+    cpu.setProgramCounter(0xC000);
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    u64 cycle = 0;
+
+    while (cycle < cycles) {
+        jitCpu.step();
+        ExecutionState* jitState = jitCpu.getExecutionState();
+        ExecutionState* state = cpu.getExecutionState();
+
+        while (state->cycle < jitState->cycle) {
+            cpu.step();
+            delete state;
+            state = cpu.getExecutionState();
+        }
+
+        assert(jitState->programCounter == state->programCounter && "JIT programcounter differs!");
+        assert(jitState->accumulator == state->accumulator && "JIT accumulator differs!");
+        assert(jitState->xRegister == state->xRegister && "JIT xRegister differs!");
+        assert(jitState->yRegister == state->yRegister && "JIT yRegister differs!");
+        assert(jitState->statusRegister == state->statusRegister && "JIT statusRegister differs!");
+        assert(jitState->stackPointer == state->stackPointer && "JIT stackpointer differs!");
+        assert(jitState->cycle == state->cycle && "JIT timing differs!");
+
+        cycle = jitState->cycle;
+        delete jitState;
+        delete state;
+    }
+
+    auto t2 = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>( t2 - t1 ).count();
+    std::cout << testROMPath << " JIT lockstep test PASSED! " << duration << " ms.\n";
+}
+
+void CPUTest::runIdleLoopTest(std::string testROMPath, int frames) {
+    TestMachine idle, machine;
+
+    if (!idle.open(testROMPath) || !machine.open(testROMPath)) {
+        return;
+    }
+
+    idle.cpu->setIdleLoopSkip(true);
+    idle.cpu->reset();
+    machine.cpu->reset();
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    //compare at every frame, the menu waits for vblank between them
+    for (int frame = 0; frame < frames; frame++) {
+        idle.runFrame();
+        machine.runFrame();
+
+        ExecutionState* idleState = idle.cpu->getExecutionState();
+        ExecutionState* state = machine.cpu->getExecutionState();
+
+        assert(idleState->programCounter == state->programCounter && "Idle skip programcounter differs!");
+        assert(idleState->accumulator == state->accumulator && "Idle skip accumulator differs!");
+        assert(idleState->statusRegister == state->statusRegister && "Idle skip statusRegister differs!");
+        assert(idleState->cycle == state->cycle && "Idle skip timing differs!");
+        assert(idle.cpu->getInstructionCount() == machine.cpu->getInstructionCount() && "Idle skip instruction count differs!");
+        assert(std::equal(idle.ppu->buffer, idle.ppu->buffer + 256 * 240, machine.ppu->buffer) && "Idle skip frame differs!");
+
+        delete idleState;
+        delete state;
+    }
+
+    assert(idle.cpu->getSkippedCycles() > 0 && "No idle loop was skipped!");
+
+    auto t2 = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>( t2 - t1 ).count();
+    std::cout << testROMPath << " idle loop test PASSED! " << duration << " ms.\n";
+}
+
+//Buttons for a frame, start the nestest run and scroll through its menu
+static u8 testInput(int frame) {
+    if (frame % 40 < 5) {
+        return 1 << (frame % 80 < 40 ? Controller::START : Controller::DOWN);
+    }
+
+    return 0;
+}
+
+static void runFrames(TestMachine& machine, int first, int count) {
+    for (int frame = first; frame < first + count; frame++) {
+        machine.controller.setButtons(testInput(frame));
+        machine.runFrame();
+    }
+}
+
+void CPUTest::runSaveStateTest(std::string testROMPath, int frames) {
+    TestMachine machine, loaded;
+
+    if (!machine.open(testROMPath) || !loaded.open(testROMPath)) {
+        return;
+    }
+
+    CPU6502& cpu = *machine.cpu;
+    SaveState* state = new SaveState();
+
+    cpu.setBlockCache(true);
+    cpu.reset();
+    runFrames(machine, 0, frames);
+
+    //save in the middle of a frame
+    for (int i = 0; i < 100; i++) {
+        cpu.step();
+    }
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    cpu.saveState(*state);
+    auto t2 = std::chrono::high_resolution_clock::now();
+
+    runFrames(machine, frames, frames);
+    ExecutionState* expected = cpu.getExecutionState();
+    std::vector<u32> expectedFrame(machine.ppu->buffer, machine.ppu->buffer + 256 * 240);
+
+    //into a fresh machine, and back into the one that saved it
+    assert(loaded.cpu->loadState(*state) && "Save state rejected!");
+    assert(cpu.loadState(*state) && "Save state rejected!");
+
+    auto t3 = std::chrono::high_resolution_clock::now();
+    cpu.loadState(*state);
+    auto t4 = std::chrono::high_resolution_clock::now();
+
+    runFrames(loaded, frames, frames);
+    runFrames(machine, frames, frames);
+
+    for (CPU6502* resumed : {loaded.cpu.get(), &cpu}) {
+        ExecutionState* actual = resumed->getExecutionState();
+        assert(actual->programCounter == expected->programCounter && "Save state programcounter differs!");
+        assert(actual->accumulator == expected->accumulator && "Save state accumulator differs!");
+        assert(actual->xRegister == expected->xRegister && "Save state xRegister differs!");
+        assert(actual->yRegister == expected->yRegister && "Save state yRegister differs!");
+        assert(actual->statusRegister == expected->statusRegister && "Save state statusRegister differs!");
+        assert(actual->stackPointer == expected->stackPointer && "Save state stackpointer differs!");
+        assert(actual->cycle == expected->cycle && "Save state timing differs!");
+        delete actual;
+    }
+
+    assert(std::equal(expectedFrame.begin(), expectedFrame.end(), loaded.ppu->buffer) && "Save state frame differs!");
+    assert(std::equal(expectedFrame.begin(), expectedFrame.end(), machine.ppu->buffer) && "Save state frame differs!");
+
+    state->mapper.romCrc32 ^= 1;
+    assert(!cpu.loadState(*state) && "Save state from another cartridge accepted!");
+    state->mapper.romCrc32 ^= 1;
+
+    state->version++;
+    assert(!cpu.loadState(*state) && "Save state from another version accepted!");
+
+    delete expected;
+    delete state;
+
+    auto save = std::chrono::duration_cast<std::chrono::microseconds>( t2 - t1 ).count();
+    auto load = std::chrono::duration_cast<std::chrono::microseconds>( t4 - t3 ).count();
+    std::cout << testROMPath << " save state test PASSED! save " << save << " us, load " << load << " us.\n";
+}
+
+void CPUTest::runScanlineRendererTest(std::string testROMPath, int frames) {
+    TestMachine machine, dot;
+
+    if (!machine.open(testROMPath) || !dot.open(testROMPath)) {
+        return;
+    }
+
+    SaveState* state = new SaveState();
+    SaveState* dotState = new SaveState();
+
+    dot.ppu->setScanlineRendering(false);
+    machine.cpu->reset();
+    dot.cpu->reset();
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    //the whole machine has to match after every frame, not just the picture
+    for (int frame = 0; frame < frames; frame++) {
+        runFrames(machine, frame, 1);
+        runFrames(dot, frame, 1);
+
+        machine.cpu->saveState(*state);
+        dot.cpu->saveState(*dotState);
+
+        assert(std::equal(dot.ppu->buffer, dot.ppu->buffer + 256 * 240, machine.ppu->buffer) && "Scanline renderer frame differs!");
+        assert(memcmp(state, dotState, sizeof(SaveState)) == 0 && "Scanline renderer state differs!");
+    }
+
+    delete state;
+    delete dotState;
+
+    auto t2 = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>( t2 - t1 ).count();
+    std::cout << testROMPath << " scanline renderer test PASSED! " << duration << " ms.\n";
+}
+
+//Every pattern address has to decode to what the mapper reads there
+static void checkTiles(Mapper& mapper, const TileCache& tiles) {
+    for (u16 address = 0; address < 0x2000; address++) {
+        const TileRow& row = tiles.row(address);
+        assert(((address & 8) ? row.hi : row.lo) == mapper.ppuread(address) && "Tile cache plane differs!");
+
+        u8 lo = mapper.ppuread(address & ~8);
+        u8 hi = mapper.ppuread(address | 8);
+
+        for (int pixel = 0; pixel < 8; pixel++) {
+            int expected = ((lo >> (7 - pixel)) & 1) | (((hi >> (7 - pixel)) & 1) << 1);
+            int flipped = ((lo >> pixel) & 1) | (((hi >> pixel) & 1) << 1);
+            assert(((row.pixels >> (14 - 2 * pixel)) & 3) == expected && "Tile cache pixel differs!");
+            assert(((row.flipped >> (14 - 2 * pixel)) & 3) == flipped && "Tile cache flipped pixel differs!");
+        }
+    }
+}
+
+//MMC1 registers are loaded one bit per write
+static void writeMMC1(MMC1& mmc1, u16 address, u8 data) {
+    for (int i = 0; i < 5; i++) {
+        mmc1.write(address, data >> i);
+    }
+}
+
+void CPUTest::runTileCacheTest() {
+    std::vector<u8> prg(0x8000);
+    std::vector<u8> chr(0x8000);
+
+    for (size_t i = 0; i < chr.size(); i++) {
+        chr[i] = i * 13 + (i >> 9);
+    }
+
+    //bank switches move the windows
+    CNROM cnrom(Cartridge::fromBytes(prg, chr, 0));
+    TileCache cnromTiles;
+    cnrom.setTileCache(&cnromTiles);
+
+    for (int bank = 0; bank < 4; bank++) {
+        cnrom.write(0x8000, bank);
+        checkTiles(cnrom, cnromTiles);
+    }
+
+    MMC1 mmc1(Cartridge::fromBytes(prg, chr, 0));
+    TileCache mmc1Tiles;
+    mmc1.setTileCache(&mmc1Tiles);
+
+    //4kb mode
+    writeMMC1(mmc1, 0x8000, 0x1C);
+
+    for (int bank = 0; bank < 8; bank++) {
+        writeMMC1(mmc1, 0xA000, bank);
+        writeMMC1(mmc1, 0xC000, 7 - bank);
+        checkTiles(mmc1, mmc1Tiles);
+    }
+
+    //CHR RAM writes redecode just the row they land in
+    MMC1 ramMMC1(Cartridge::fromBytes(prg, {}, 0));
+    TileCache ramTiles;
+    ramMMC1.setTileCache(&ramTiles);
+
+    for (u16 address = 0; address < 0x2000; address += 7) {
+        ramMMC1.ppuwrite(address, address * 5);
+    }
+
+    checkTiles(ramMMC1, ramTiles);
+
+    std::cout << "Tile cache test PASSED!\n";
+}
+
+//Every PRG and CHR address has to read what the bank registers select, worked
+//out a byte at a time the way the boards used to. Banks past the end wrap.
+static void checkBanks(Mapper& mapper, const std::vector<u8>& prg, const std::vector<u8>& chr,
+                       std::function<u32(u16)> prgOffset, std::function<u32(u16)> chrOffset) {
+    for (u32 address = 0x8000; address <= 0xFFFF; address++) {
+        assert(mapper.read(address) == prg[prgOffset(address) % prg.size()] && "PRG bank page differs!");
+    }
+
+    for (u16 address = 0; address < 0x2000; address++) {
+        assert(mapper.ppuread(address) == chr[chrOffset(address) % chr.size()] && "CHR bank page differs!");
+    }
+}
+
+void CPUTest::runBankPagesTest() {
+    std::vector<u8> prg(0x20000);
+    std::vector<u8> chr(0x8000);
+
+    for (size_t i = 0; i < prg.size(); i++) {
+        prg[i] = i * 7 + (i >> 13);
+    }
+
+    for (size_t i = 0; i < chr.size(); i++) {
+        chr[i] = i * 13 + (i >> 10);
+    }
+
+    std::vector<u8> smallPrg(prg.begin(), prg.begin() + 0x4000);
+    std::vector<u8> smallChr(chr.begin(), chr.begin() + 0x2000);
+    auto fixedChr = [](u16 address) { return (u32)address; };
+
+    //16kb NROM is mirrored
+    NROM nrom(Cartridge::fromBytes(smallPrg, smallChr, 0));
+    checkBanks(nrom, smallPrg, smallChr, [](u16 address) { return (u32)((address - 0x8000) % 0x4000); }, fixedChr);
+
+    UnROM unrom(Cartridge::fromBytes(prg, smallChr, 0));
+
+    for (int bank = 0; bank < 8; bank++) {
+        unrom.write(0x8000, bank);
+        checkBanks(unrom, prg, smallChr, [=](u16 address) {
+            return address >= 0xC000 ? (u32)(prg.size() - 0x4000 + (address - 0xC000)) : (u32)((address - 0x8000) + bank * 0x4000);
+        }, fixedChr);
+    }
+
+    CNROM cnrom(Cartridge::fromBytes(smallPrg, chr, 0));
+
+    for (int bank = 0; bank < 4; bank++) {
+        cnrom.write(0x8000, bank);
+        checkBanks(cnrom, smallPrg, chr, [](u16 address) { return (u32)((address - 0x8000) % 0x4000); },
+                   [=](u16 address) { return (u32)(bank * 0x2000 + address); });
+    }
+
+    //CHR ROM isn't written
+    u8 before = cnrom.ppuread(0x123);
+    cnrom.ppuwrite(0x123, before ^ 0xFF);
+    assert(cnrom.ppuread(0x123) == before && "CNROM CHR written!");
+
+    //every PRG mode with both CHR modes
+    MMC1 mmc1(Cartridge::fromBytes(prg, chr, 0));
+
+    for (int control = 0; control < 0x20; control += 4) {
+        for (int bank = 0; bank < 8; bank++) {
+            writeMMC1(mmc1, 0x8000, control);
+            writeMMC1(mmc1, 0xA000, bank);
+            writeMMC1(mmc1, 0xC000, 7 - bank);
+            writeMMC1(mmc1, 0xE000, bank);
+
+            int prgMode = (control >> 2) & 3;
+            bool chr4k = control & 0x10;
+
+            checkBanks(mmc1, prg, chr, [=](u16 address) {
+                if (prgMode <= 1) {
+                    return (u32)((address - 0x8000) + (bank & 0xE) * 0x8000);
+                } else if (prgMode == 2) {
+                    return address < 0xC000 ? (u32)(address - 0x8000) : (u32)((address - 0xC000) + bank * 0x4000);
+                }
+
+                return address < 0xC000 ? (u32)((address - 0x8000) + bank * 0x4000) : (u32)(prg.size() - 0x4000 + (address - 0xC000));
+            }, [=](u16 address) {
+                if (!chr4k) {
+                    return (u32)((bank & 0x1E) * 0x2000 + address);
+                }
+
+                return address < 0x1000 ? (u32)(bank * 0x1000 + address) : (u32)((7 - bank) * 0x1000 + (address - 0x1000));
+            });
+        }
+    }
+
+    //PRG RAM reads back until it's disabled
+    writeMMC1(mmc1, 0xE000, 0);
+    mmc1.write(0x6123, 0x5A);
+    assert(mmc1.read(0x6123) == 0x5A && "PRG RAM differs!");
+    writeMMC1(mmc1, 0xE000, 0x10);
+    assert(mmc1.read(0x6123) == 0 && "Disabled PRG RAM read!");
+
+    //CHR RAM writes land in the selected 4kb bank
+    MMC1 ramMMC1(Cartridge::fromBytes(prg, {}, 0));
+    writeMMC1(ramMMC1, 0x8000, 0x1C);
+    writeMMC1(ramMMC1, 0xA000, 1);
+    ramMMC1.ppuwrite(0x0010, 0xA5);
+    writeMMC1(ramMMC1, 0xA000, 0);
+    assert(ramMMC1.ppuread(0x1010) == 0 && ramMMC1.ppuread(0x0010) == 0 && "CHR RAM write missed its bank!");
+    writeMMC1(ramMMC1, 0xC000, 1);
+    assert(ramMMC1.ppuread(0x1010) == 0xA5 && "CHR RAM write missed its bank!");
+
+    std::cout << "Bank pages test PASSED!\n";
+}
+
+static void writeFile(const std::string& path, const std::vector<char>& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), bytes.size());
+}
+
+void CPUTest::runRomImageTest(std::string testROMPath) {
+    ROM rom, sameRom;
+    rom.open(testROMPath);
+    sameRom.open(testROMPath);
+    const Cartridge& cartridge = rom.getCartridge();
+
+    //one mapping for every machine, PRG read out of it in place
+    assert(cartridge.image != nullptr && cartridge.image == sameRom.getCartridge().image && "ROM image not shared!");
+    assert(cartridge.prg == sameRom.getCartridge().prg && "PRG not shared!");
+    assert(cartridge.chr != nullptr && "CHR ROM missing!");
+
+    Mapper* mapper = rom.getMapper();
+    Mapper* sameMapper = sameRom.getMapper();
+
+    for (u32 address = 0x8000; address <= 0xFFFF; address++) {
+        assert(mapper->read(address) == cartridge.prg[(address - 0x8000) % cartridge.prgSize] && "PRG differs from the image!");
+    }
+
+    //CHR ROM can't be written, neither through this machine nor the other
+    u8 before = mapper->ppuread(0x10);
+    mapper->ppuwrite(0x10, before ^ 0xFF);
+    assert(mapper->ppuread(0x10) == before && sameMapper->ppuread(0x10) == before && "CHR ROM written!");
+
+    delete mapper;
+    delete sameMapper;
+
+    //every board has its own CHR RAM
+    std::vector<u8> prg(0x8000);
+    Cartridge ramCartridge = Cartridge::fromBytes(prg, {}, 0);
+    NROM ramMapper(ramCartridge);
+    NROM otherRamMapper(ramCartridge);
+    ramMapper.ppuwrite(0x10, 0x5A);
+    assert(ramMapper.ppuread(0x10) == 0x5A && "CHR RAM not written!");
+    assert(otherRamMapper.ppuread(0x10) == 0 && "CHR RAM shared!");
+
+    ROM missing;
+    missing.open(testROMPath + ".missing");
+    assert(missing.getMapper() == NULL && "Missing ROM opened!");
+
+    //NES 2.0 exponent sizes that aren't whole banks: 16 bytes of PRG, then
+    //16kb of PRG with 24 bytes of CHR
+    const char* partialBanks[] = {"NES\x1A\x10\x00\x00\x08\x00\x0F\x00\x00\x00\x00\x00\x00",
+                                  "NES\x1A\x01\x0D\x00\x08\x00\xF0\x00\x00\x00\x00\x00\x00"};
+    char partialPath[] = "/tmp/mednes-partial-XXXXXX";
+    close(mkstemp(partialPath));
+
+    for (const char* partialHeader : partialBanks) {
+        std::vector<char> partial(partialHeader, partialHeader + sizeof(INESHeader));
+        partial.resize(sizeof(INESHeader) + 0x4000 + 24);
+        writeFile(partialPath, partial);
+
+        ROM partialRom;
+        partialRom.open(partialPath);
+        const RomInfo& partialInfo = partialRom.getInfo();
+        assert(partialInfo.nes20 && (partialInfo.prgRomSize == 16 || partialInfo.chrRomSize == 24) && "Partial bank header misread!");
+        assert(partialRom.getCartridge().image == nullptr && partialRom.getMapper() == NULL && "Partial bank ROM opened!");
+    }
+
+    remove(partialPath);
+
+    std::cout << testROMPath << " ROM image test PASSED!\n";
+}
+
+static std::string hex(const Sha1::Digest& digest) {
+    std::string text;
+
+    for (u8 byte : digest) {
+        char digits[3];
+        snprintf(digits, sizeof(digits), "%02x", byte);
+        text += digits;
+    }
+
+    return text;
+}
+
+static INESHeader header(const char* bytes) {
+    INESHeader header;
+    memcpy(&header, bytes, sizeof(header));
+    return header;
+}
+
+void CPUTest::runRomInfoTest(std::string testROMPath) {
+    const char* check = "123456789";
+    const char* twoBlocks = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    assert(Crc32::compute((const u8*)check, 9) == 0xCBF43926 && "CRC32 differs!");
+    assert(hex(Sha1::compute(nullptr, 0)) == "da39a3ee5e6b4b0d3255bfef95601890afd80709" && "SHA-1 differs!");
+    assert(hex(Sha1::compute((const u8*)"abc", 3)) == "a9993e364706816aba3e25717850c26c9cd0d89d" && "SHA-1 differs!");
+    assert(hex(Sha1::compute((const u8*)twoBlocks, 56)) == "84983e441c3bd26ebaae4aa1f95129e5e54670f1" && "SHA-1 differs!");
+
+    //the sliced CRC against a bit at a time, from every alignment and continued
+    std::vector<u8> bytes(1000);
+    u32 bitwise = ~0u;
+
+    for (size_t i = 0; i < bytes.size(); i++) {
+        bytes[i] = i * 131 + (i >> 3);
+        bitwise ^= bytes[i];
+
+        for (int bit = 0; bit < 8; bit++) {
+            bitwise = (bitwise >> 1) ^ (bitwise & 1 ? 0xEDB88320 : 0);
+        }
+    }
+
+    for (size_t split = 0; split < 17; split++) {
+        u32 crc = Crc32::compute(bytes.data() + split, bytes.size() - split, Crc32::compute(bytes.data(), split));
+        assert(crc == ~bitwise && "Sliced CRC32 differs!");
+    }
+
+    ROM rom;
+    rom.open(testROMPath);
+    const RomInfo& info = rom.getInfo();
+    assert(!info.nes20 && info.mapper == 0 && info.prgRomSize == 0x4000 && info.chrRomSize == 0x2000 && "Header misread!");
+    assert(!info.battery && !info.trainer && !info.fourScreen && info.prgRamSize == 0x2000 && "Header misread!");
+    assert(info.crc32 == 0x158B0388 && hex(info.sha1) == "4131307f0f69f2a5c54b7d438328c5b2a5ed0820" && "ROM hash differs!");
+    assert(rom.getCartridge().crc32 == info.crc32 && "Cartridge hash differs!");
+
+    //NES 2.0: mapper 0x1A3.2, 24 bytes of PRG in exponent form, 8kb each of PRG NVRAM and CHR RAM, PAL
+    RomInfo nes20 = RomInfo::parse(header("NES\x1A\x0D\x00\x32\xA8\x21\x0F\x70\x07\x01\x00\x00\x00"));
+    assert(nes20.nes20 && nes20.mapper == 0x1A3 && nes20.submapper == 2 && "NES 2.0 mapper misread!");
+    assert(nes20.prgRomSize == 24 && nes20.chrRomSize == 0 && "NES 2.0 ROM size misread!");
+    assert(nes20.prgRamSize == 0 && nes20.prgNvramSize == 0x2000 && nes20.chrRamSize == 0x2000 && "NES 2.0 RAM size misread!");
+    assert(nes20.battery && nes20.timing == 1 && "NES 2.0 flags misread!");
+
+    //"DiskDude!" over bytes 7-15 leaves only the low mapper nibble
+    RomInfo junk = RomInfo::parse(header("NES\x1A\x02\x01\x11" "DiskDude!"));
+    assert(!junk.nes20 && junk.mapper == 1 && junk.mirroring == 1 && junk.battery == false && "Junk header misread!");
+
+    //iNES battery RAM, 0 meaning 8kb
+    RomInfo battery = RomInfo::parse(header("NES\x1A\x02\x00\x12\x00\x00\x00\x00\x00\x00\x00\x00\x00"));
+    assert(battery.mapper == 1 && battery.chrRamSize == 0x2000 && battery.prgRamSize == 0 && battery.prgNvramSize == 0x2000 && "iNES RAM misread!");
+
+    std::cout << testROMPath << " ROM info test PASSED!\n";
+}
+
+static void checkSameEntries(const RomLibrary& library, const RomLibrary& other) {
+    assert(library.getEntries().size() == other.getEntries().size() && "Library entries differ!");
+
+    for (size_t i = 0; i < library.getEntries().size(); i++) {
+        const RomEntry& a = library.getEntries()[i];
+        const RomEntry& b = other.getEntries()[i];
+        assert(a.path == b.path && a.size == b.size && a.mtime == b.mtime && "Library entry differs!");
+        assert(a.valid == b.valid && a.supported == b.supported && "Library entry differs!");
+        assert(a.info.mapper == b.info.mapper && a.info.prgRomSize == b.info.prgRomSize && a.info.chrRomSize == b.info.chrRomSize &&
+               a.info.prgRamSize == b.info.prgRamSize && a.info.mirroring == b.info.mirroring && a.info.battery == b.info.battery &&
+               a.info.crc32 == b.info.crc32 && a.info.sha1 == b.info.sha1 && "Library entry info differs!");
+    }
+}
+
+void CPUTest::runRomLibraryTest(std::string testROMPath) {
+    std::ifstream in(testROMPath, std::ios::binary);
+    std::vector<char> rom((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    char root[] = "/tmp/mednes-library-XXXXXX";
+    assert(mkdtemp(root) != nullptr && "No temporary directory!");
+    std::string dir = root;
+    mkdir((dir + "/sub").c_str(), 0755);
+    mkdir((dir + "/.hidden").c_str(), 0755);
+
+    //the same game as MMC3, which has no board yet
+    std::vector<char> mmc3 = rom;
+    mmc3[6] = 0x40;
+
+    writeFile(dir + "/a.nes", rom);
+    writeFile(dir + "/sub/b.NES", mmc3);
+    writeFile(dir + "/sub/broken.nes", std::vector<char>(rom.begin(), rom.begin() + 1000));
+    writeFile(dir + "/sub/notes.txt", rom);
+    writeFile(dir + "/.hidden/c.nes", rom);
+
+    RomLibrary library;
+    RomScanStats stats = library.scan(dir, 4);
+    const std::vector<RomEntry>& entries = library.getEntries();
+    assert(stats.files == 3 && stats.opened == 3 && stats.reused == 0 && entries.size() == 3 && "Scan found the wrong files!");
+    assert(entries[0].path == "a.nes" && entries[1].path == "sub/b.NES" && entries[2].path == "sub/broken.nes" && "Scan paths differ!");
+    assert(entries[0].valid && entries[0].supported && entries[0].info.crc32 == 0x158B0388 && entries[0].size == rom.size() && "ROM entry differs!");
+    assert(entries[1].valid && !entries[1].supported && entries[1].info.mapper == 4 && entries[1].info.crc32 == 0x158B0388 && "Unsupported entry differs!");
+    assert(!entries[2].valid && !entries[2].supported && "Broken ROM indexed!");
+
+    //an index round trip keeps everything, a rescan opens nothing
+    std::string indexPath = dir + "/mednes.index";
+    assert(library.save(indexPath) && "Index not written!");
+    RomLibrary loaded;
+    assert(loaded.load(indexPath) && "Index not read!");
+    checkSameEntries(library, loaded);
+
+    stats = loaded.scan(dir, 4);
+    assert(stats.files == 3 && stats.reused == 3 && stats.opened == 0 && stats.removed == 0 && "Unchanged files opened!");
+    checkSameEntries(library, loaded);
+
+    //a changed file is opened again, a deleted one dropped
+    mmc3.push_back(0);
+    mmc3[6] = 0x10;
+    writeFile(dir + "/sub/b.NES", mmc3);
+    remove((dir + "/sub/broken.nes").c_str());
+    stats = loaded.scan(dir, 4);
+    assert(stats.files == 2 && stats.reused == 1 && stats.opened == 1 && stats.removed == 1 && "Rescan differs!");
+    assert(loaded.getEntries()[1].supported && loaded.getEntries()[1].info.mapper == 1 && "Changed file not reopened!");
+
+    //a cut short index is rejected
+    std::ifstream indexIn(indexPath, std::ios::binary);
+    std::vector<char> index((std::istreambuf_iterator<char>(indexIn)), std::istreambuf_iterator<char>());
+    index.pop_back();
+    writeFile(indexPath, index);
+    assert(!loaded.load(indexPath) && "Broken index read!");
+
+    remove(indexPath.c_str());
+    remove((dir + "/a.nes").c_str());
+    remove((dir + "/sub/b.NES").c_str());
+    remove((dir + "/sub/notes.txt").c_str());
+    remove((dir + "/.hidden/c.nes").c_str());
+    rmdir((dir + "/sub").c_str());
+    rmdir((dir + "/.hidden").c_str());
+    rmdir(dir.c_str());
+
+    std::cout << testROMPath << " ROM library test PASSED!\n";
+}
+
+//VRAM offset of a nametable address under iNES/MMC1 mirroring
+static int mirroredOffset(u16 address, int mirroring) {
+    address &= 0xFFF;
+
+    if (mirroring == 0) {
+        return (address & 0x3FF) | ((address & 0x800) >> 1);
+    } else if (mirroring == 1) {
+        return address & 0x7FF;
+    }
+
+    return (address & 0x3FF) | (mirroring == 3 ? 0x400 : 0);
+}
+
+void CPUTest::runMirroringTest() {
+    std::vector<u8> prg(0x8000);
+    std::vector<u8> chr(0x2000);
+    MMC1 mapper(Cartridge::fromBytes(prg, chr, 1));
+    PPU* ppu = new PPU(&mapper);
+
+    //MMC1 control values for one screen lower, upper, vertical and horizontal
+    const int mirrorings[4] = {2, 3, 1, 0};
+
+    for (int control = 0; control < 4; control++) {
+        int mirroring = mirrorings[control];
+        writeMMC1(mapper, 0x8000, 0x0C | control);
+        assert(mapper.getMirroring() == mirroring && "MMC1 mirroring differs!");
+
+        //the last write to each VRAM byte wins, mirrors included
+        u8 expected[2048] = {0};
+
+        for (u16 address = 0x2000; address < 0x3000; address++) {
+            u8 data = address * 7 + control;
+            ppu->ppuwrite(address, data);
+            expected[mirroredOffset(address, mirroring)] = data;
+        }
+
+        for (u16 address = 0x2000; address < 0x3F00; address++) {
+            assert(ppu->ppuread(address) == expected[mirroredOffset(address, mirroring)] && "Nametable mirroring differs!");
+        }
+    }
+
+    delete ppu;
+
+    std::cout << "Nametable mirroring test PASSED!\n";
+}
+
+void CPUTest::runCompositorTest(int lines) {
+    LineLayers layers;
+    u8 pixels[256];
+    u8 expected[256];
+    int hits = 0;
+
+    srand(1);
+
+    //random lines with sprites from sparse to dense, both layers on and off
+    for (int line = 0; line < lines; line++) {
+        int density = line % 4;
+
+        for (int i = 0; i < 256; i++) {
+            layers.background[i] = rand() & 15;
+            layers.sprite[i] = (rand() % 4 <= density) ? 0 : 0x10 | (rand() & 15);
+            layers.spriteFlags[i] = rand() & 1;
+
+            if (rand() % 64 == 0) {
+                layers.spriteFlags[i] |= LineLayers::SPRITE_ZERO;
+            }
+        }
+
+        bool showBg = line & 4;
+        bool showSprites = line & 8;
+        bool hit = composeLine(layers, showBg, showSprites, pixels);
+
+        assert(hit == composeLineScalar(layers, showBg, showSprites, expected) && "Compositor sprite zero hit differs!");
+        assert(std::equal(expected, expected + 256, pixels) && "Compositor pixels differ!");
+        hits += hit;
+    }
+
+    assert(hits > 0 && "No sprite zero hit was composed!");
+    std::cout << compositorName() << " compositor test PASSED!\n";
+}
+
+//Runs OAM dot by dot and through whole lines, the overflow flag has to go up
+//on the given dot of line 50 and where nextStatusChange said, or never
+static void checkOverflow(const u8* oam, int expectedDot) {
+    std::vector<u8> prg(0x8000);
+    std::vector<u8> chr(0x2000);
+    NROM mapper(Cartridge::fromBytes(prg, chr, 0));
+    NROM lineMapper(Cartridge::fromBytes(prg, chr, 0));
+    PPU* ppu = new PPU(&mapper);
+    PPU* linePpu = new PPU(&lineMapper);
+    const u64 frame = DOTS_PER_SCANLINE * SCANLINES_PER_FRAME * PPU_CLOCK_DIVIDER;
+
+    //sprites only, so there are no sprite zero hits
+    ppu->setScanlineRendering(false);
+    ppu->write(0x2001, 0x10);
+    linePpu->write(0x2001, 0x10);
+    ppu->copyOAMPage(oam);
+    linePpu->copyOAMPage(oam);
+
+    u64 predicted = ppu->nextStatusChange();
+
+    if (expectedDot == 0) {
+        assert(predicted == Scheduler::NEVER && "Sprite overflow predicted!");
+        ppu->catchUp(frame - 1);
+        assert(!(ppu->peekStatus() & 0x20) && "Sprite overflow set!");
+    } else {
+        assert(predicted == (50 * DOTS_PER_SCANLINE + expectedDot) * PPU_CLOCK_DIVIDER + 1 && "Sprite overflow predicted on the wrong dot!");
+        ppu->catchUp(predicted - 1);
+        assert(!(ppu->peekStatus() & 0x20) && "Sprite overflow set early!");
+        ppu->catchUp(predicted);
+        assert((ppu->peekStatus() & 0x20) && "Sprite overflow not set!");
+    }
+
+    linePpu->catchUp(51 * DOTS_PER_SCANLINE * PPU_CLOCK_DIVIDER);
+    assert(!(linePpu->peekStatus() & 0x20) == (expectedDot == 0) && "Scanline renderer sprite overflow differs!");
+
+    delete ppu;
+    delete linePpu;
+}
+
+void CPUTest::runSpriteEvalTest(int oams) {
+    u8 oam[256];
+    int found = 0;
+
+    srand(1);
+
+    //random OAM with Y clustered from all over to near the top, every line
+    //and both sprite heights
+    for (int i = 0; i < oams; i++) {
+        for (int n = 0; n < 256; n++) {
+            oam[n] = rand() % (256 >> (i % 4));
+        }
+
+        for (int height = 8; height <= 16; height += 8) {
+            for (int line = 0; line < 256; line++) {
+                u64 mask = spritesOnLine(oam, line, height);
+                assert(mask == spritesOnLineScalar(oam, line, height) && "Sprite evaluation differs!");
+                found += mask != 0;
+            }
+        }
+    }
+
+    assert(found > 0 && "No sprite was on a line!");
+
+    //eight sprites on line 50 and the rest below the screen
+    memset(oam, 0xF0, sizeof(oam));
+
+    for (int n = 0; n < 8; n++) {
+        oam[n * 4] = 50;
+    }
+
+    checkOverflow(oam, 0);
+
+    //a ninth is found after 8 sprites taking 8 dots each
+    oam[8 * 4] = 50;
+    checkOverflow(oam, 65 + 8 * 2 + 8 * 6);
+
+    //the scan after the eighth reads the tile number of sprite 9 as Y...
+    oam[8 * 4] = 0xF0;
+    oam[9 * 4 + 1] = 50;
+    checkOverflow(oam, 65 + 9 * 2 + 8 * 6);
+
+    //...and misses its real Y
+    oam[9 * 4 + 1] = 0xF0;
+    oam[9 * 4] = 50;
+    checkOverflow(oam, 0);
+
+    std::cout << spriteEvalName() << " sprite evaluation test PASSED!\n";
+}
+
+//ARGB, 8-bit and 16-bit indexed output side by side, the indexed frames have to
+//expand to the ARGB one
+void CPUTest::runIndexedOutputTest(std::string testROMPath, int frames) {
+    const PixelFormat formats[3] = {PixelFormat::ARGB8888, PixelFormat::INDEXED8, PixelFormat::INDEXED16};
+    TestMachine machines[3];
+
+    for (int i = 0; i < 3; i++) {
+        if (!machines[i].open(testROMPath)) {
+            return;
+        }
+
+        machines[i].ppu->setPixelFormat(formats[i]);
+        machines[i].cpu->reset();
+    }
+
+    PPU* argb = machines[0].ppu.get();
+    u32* expanded = new u32[256 * 240];
+    u32* abgr = new u32[256 * 240];
+    long compared = 0;
+
+    for (int frame = 0; frame < frames; frame++) {
+        for (TestMachine& machine : machines) {
+            machine.runFrame();
+        }
+
+        argb->convertFrame(abgr, PixelFormat::ABGR8888);
+
+        for (int i = 1; i < 3; i++) {
+            machines[i].ppu->convertFrame(expanded, PixelFormat::ARGB8888);
+
+            for (int pixel = 0; pixel < 256 * 240; pixel++) {
+                assert(expanded[pixel] == argb->buffer[pixel] && "Indexed output differs!");
+                compared += argb->buffer[pixel] != 0;
+            }
+
+            machines[i].ppu->convertFrame(expanded, PixelFormat::ABGR8888);
+            assert(memcmp(expanded, abgr, 256 * 240 * sizeof(u32)) == 0 && "Indexed ABGR output differs!");
+        }
+    }
+
+    assert(compared > 0 && "No pixel was drawn!");
+
+    delete[] expanded;
+    delete[] abgr;
+
+    std::cout << testROMPath << " indexed output test PASSED!\n";
+}
+
+//Frames drawn into targets with padded rows, swapped every frame like a
+//front end flipping buffers, have to match the frame buffer of a PPU without
+//one. The targets start out filled so a pixel left undrawn shows up, and the
+//padding has to stay as it was. Half way through they go indexed.
+void CPUTest::runFrameTargetTest(std::string testROMPath, int frames) {
+    const int pitch = 256 * sizeof(u32) + 64;
+    const u8 FILL = 0xCD;
+    TestMachine machine, targeted;
+
+    if (!machine.open(testROMPath) || !targeted.open(testROMPath)) {
+        return;
+    }
+
+    machine.cpu->reset();
+    targeted.cpu->reset();
+
+    std::vector<u8> targets[2] = {std::vector<u8>(240 * pitch), std::vector<u8>(240 * pitch)};
+    std::vector<u32> frame(256 * 240);
+
+    for (int f = 0; f < frames; f++) {
+        std::vector<u8>& target = targets[f & 1];
+        PixelFormat format = f < frames / 2 ? PixelFormat::ARGB8888 : PixelFormat::INDEXED16;
+        int rowBytes = f < frames / 2 ? 256 * sizeof(u32) : 256 * sizeof(u16);
+
+        std::fill(target.begin(), target.end(), FILL);
+        targeted.ppu->setFrameTarget({target.data(), pitch, format});
+
+        machine.runFrame();
+        targeted.runFrame();
+
+        targeted.ppu->convertFrame(frame.data(), PixelFormat::ARGB8888);
+        assert(memcmp(frame.data(), machine.ppu->buffer, 256 * 240 * sizeof(u32)) == 0 && "Frame target output differs!");
+
+        for (int line = 0; line < 240; line++) {
+            const u8* row = target.data() + line * pitch;
+            assert(std::all_of(row + rowBytes, row + pitch, [=](u8 b) { return b == FILL; }) && "Frame target padding written!");
+        }
+    }
+
+    //the PPU draws into its own buffer again
+    targeted.ppu->clearFrameTarget();
+    targeted.ppu->setPixelFormat(PixelFormat::ARGB8888);
+
+    machine.runFrame();
+    targeted.runFrame();
+
+    assert(memcmp(targeted.ppu->buffer, machine.ppu->buffer, sizeof(machine.ppu->buffer)) == 0 && "Frame buffer output differs!");
+
+    std::cout << testROMPath << " frame target test PASSED!\n";
+}
+
+//A producer thread fills every frame with its number and publishes it while
+//this thread acquires. No frame may come torn or out of order or change while
+//it is held, and every frame is either acquired or counted as dropped.
+void CPUTest::runTripleBufferTest(int frames) {
+    TripleBuffer<u32> buffer(256 * 240);
+    u64 acquired = 0;
+    u32 last = 0;
+
+    std::thread producer([&]() {
+        for (u32 frame = 1; frame <= (u32)frames; frame++) {
+            std::fill(buffer.back(), buffer.back() + 256 * 240, frame);
+            buffer.publish();
+
+            //let the consumer in mid-run even on a single core
+            if (frame % 3 == 0) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    while (last != (u32)frames) {
+        if (!buffer.acquire()) {
+            continue;
+        }
+
+        const u32* front = buffer.front();
+        assert(front[0] > last && "Frame out of order!");
+        assert(std::all_of(front, front + 256 * 240, [=](u32 pixel) { return pixel == front[0]; }) && "Torn frame!");
+        last = front[0];
+        acquired++;
+
+        //the front buffer is the consumer's until the next acquire
+        std::this_thread::yield();
+        assert(front[0] == last && front[256 * 240 - 1] == last && "Front buffer written!");
+    }
+
+    producer.join();
+    assert(!buffer.acquire() && "Frame acquired twice!");
+    assert(acquired + buffer.getDropped() == (u64)frames && "Frames lost!");
+
+    //60 fps shown at 144 Hz: every frame is new but alternates 2 and 3 presents
+    FramePacing pacing;
+    FramePacing::Clock::time_point when;
+
+    for (int present = 0; present < 144; present++) {
+        bool newFrame = present % 12 == 0 || present % 12 == 3 || present % 12 == 5 || present % 12 == 8 || present % 12 == 10;
+        pacing.present(newFrame, when);
+        when += std::chrono::microseconds(6944);
+    }
+
+    FramePacingStats stats = pacing.stats();
+    assert(stats.presented == 144 && stats.repeated == 144 - 60 && "Frame pacing counts differ!");
+    assert(stats.p50 > 13.8 && stats.p50 < 13.9 && stats.p99 > 20.8 && stats.p99 < 20.9 && "Frame time percentiles differ!");
+
+    std::cout << "Triple buffer test PASSED! " << acquired << " of " << frames << " frames acquired.\n";
+}
+
+//Sprite 0 over an opaque background, a PPU that draws and one that never does
+//have to see the hit at the same time. Catch-up steps of a whole line go
+//through the scanline renderer, the others split lines and run dot by dot.
+static void checkSkippedSpriteZeroHit(u64 step) {
+    std::vector<u8> prg(0x8000);
+    std::vector<u8> chr(0x2000);
+    u8 oam[256];
+
+    //tile 0 is opaque, every nametable byte points at it
+    for (int i = 0; i < 8; i++) {
+        chr[i] = 0xFF;
+    }
+
+    memset(oam, 0xF0, sizeof(oam));
+    oam[0] = 100;
+    oam[1] = 0;
+    oam[2] = 0;
+    oam[3] = 100;
+
+    NROM mapper(Cartridge::fromBytes(prg, chr, 0));
+    NROM skipMapper(Cartridge::fromBytes(prg, chr, 0));
+    PPU* ppu = new PPU(&mapper);
+    PPU* skipPpu = new PPU(&skipMapper);
+    int hits = 0;
+
+    skipPpu->setDrawInterval(0);
+
+    for (PPU* p : {ppu, skipPpu}) {
+        p->write(0x2001, 0x1E);
+        p->copyOAMPage(oam);
+    }
+
+    for (u64 clock = step; clock < 3 * DOTS_PER_SCANLINE * SCANLINES_PER_FRAME * PPU_CLOCK_DIVIDER; clock += step) {
+        ppu->catchUp(clock);
+        skipPpu->catchUp(clock);
+        assert(ppu->peekStatus() == skipPpu->peekStatus() && "Skipped frame sprite zero hit differs!");
+        hits += (skipPpu->peekStatus() & 0x40) && !skipPpu->isFrameDrawn();
+    }
+
+    assert(hits > 0 && "No sprite zero hit on a skipped frame!");
+
+    delete ppu;
+    delete skipPpu;
+}
+
+//A machine drawing every frame and one drawing some of them run the same
+//recorded input, their whole state has to match after every frame, and the
+//drawn frames have to match too
+void CPUTest::runFrameSkipTest(std::string testROMPath, int frames, int drawInterval) {
+    TestMachine machine, skip;
+
+    if (!machine.open(testROMPath) || !skip.open(testROMPath)) {
+        return;
+    }
+
+    SaveState* state = new SaveState();
+    SaveState* skipState = new SaveState();
+    int drawn = 0;
+
+    skip.ppu->setDrawInterval(drawInterval);
+    machine.cpu->reset();
+    skip.cpu->reset();
+    srand(1);
+
+    for (int frame = 0; frame < frames; frame++) {
+        //hold random buttons for a few frames at a time
+        if (frame % 8 == 0) {
+            u8 buttons = rand() & 0xFF;
+            machine.controller.setButtons(buttons);
+            skip.controller.setButtons(buttons);
+        }
+
+        //every few frames one is asked for on top of the interval
+        if (frame % 5 == 0) {
+            skip.ppu->requestFrame();
+        }
+
+        machine.runFrame();
+        skip.runFrame();
+
+        machine.cpu->saveState(*state);
+        skip.cpu->saveState(*skipState);
+        assert(memcmp(state, skipState, sizeof(SaveState)) == 0 && "Frame skip state differs!");
+
+        if (skip.ppu->isFrameDrawn()) {
+            assert(memcmp(machine.ppu->buffer, skip.ppu->buffer, sizeof(machine.ppu->buffer)) == 0 && "Drawn frame differs!");
+            drawn++;
+        }
+    }
+
+    assert(drawn > 0 && drawn < frames && "No frame was skipped or drawn!");
+
+    checkSkippedSpriteZeroHit(DOTS_PER_SCANLINE * PPU_CLOCK_DIVIDER);
+    checkSkippedSpriteZeroHit(1000);
+
+    delete state;
+    delete skipState;
+
+    std::cout << testROMPath << " frame skip test PASSED! " << drawn << " of " << frames << " frames drawn.\n";
+}
+
+void CPUTest::runPixelFormatTest(std::string testROMPath, int frames) {
+    TestMachine machine, abgrMachine;
+
+    if (!machine.open(testROMPath) || !abgrMachine.open(testROMPath)) {
+        return;
+    }
+
+    abgrMachine.ppu->setPixelFormat(PixelFormat::ABGR8888);
+    machine.cpu->reset();
+    abgrMachine.cpu->reset();
+
+    runFrames(machine, 0, frames);
+    runFrames(abgrMachine, 0, frames);
+
+    for (int i = 0; i < 256 * 240; i++) {
+        u32 argb = machine.ppu->buffer[i];
+        u32 abgr = (argb & 0xFF00FF00) | ((argb >> 16) & 0xFF) | ((argb & 0xFF) << 16);
+        assert(abgrMachine.ppu->buffer[i] == abgr && "ABGR frame differs!");
+    }
+
+    std::cout << testROMPath << " pixel format test PASSED!\n";
+}
@@ -3,6 +3,9 @@
 
 #include <stdio.h>
 #include "6502.hpp"
+#include "ROM.hpp"
+
+using namespace MedNES;
 
 class CPUTest {
 private:
@@ -10,7 +13,24 @@ private:
     
 public:
     CPUTest() {};
-    void runTest(std::string, std::string);
+    void runTest(std::string, std::string, bool blockCache = false);
+    void runJitLockstepTest(std::string, u64);
+    void runIdleLoopTest(std::string, int);
+    void runSaveStateTest(std::string, int);
+    void runScanlineRendererTest(std::string, int);
+    void runTileCacheTest();
+    void runMirroringTest();
+    void runBankPagesTest();
+    void runRomImageTest(std::string);
+    void runRomInfoTest(std::string);
+    void runRomLibraryTest(std::string);
+    void runCompositorTest(int);
+    void runSpriteEvalTest(int);
+    void runFrameSkipTest(std::string, int, int);
+    void runPixelFormatTest(std::string, int);
+    void runIndexedOutputTest(std::string, int);
+    void runFrameTargetTest(std::string, int);
+    void runTripleBufferTest(int);
     
 };
 
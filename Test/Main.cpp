@@ -0,0 +1,27 @@
+#include "CPUTest.hpp"
+
+int main() {
+    CPUTest cpuTest;
+    cpuTest.runTest("Test/nestest.nes", "Test/nestest.log");
+    cpuTest.runTest("Test/nestest.nes", "Test/nestest.log", true);
+    cpuTest.runJitLockstepTest("Test/nestest.nes", 26554);
+    cpuTest.runIdleLoopTest("Test/nestest.nes", 120);
+    cpuTest.runSaveStateTest("Test/nestest.nes", 60);
+    cpuTest.runScanlineRendererTest("Test/nestest.nes", 240);
+    cpuTest.runTileCacheTest();
+    cpuTest.runMirroringTest();
+    cpuTest.runBankPagesTest();
+    cpuTest.runRomImageTest("Test/nestest.nes");
+    cpuTest.runRomInfoTest("Test/nestest.nes");
+    cpuTest.runRomLibraryTest("Test/nestest.nes");
+    cpuTest.runCompositorTest(4096);
+    cpuTest.runSpriteEvalTest(256);
+    cpuTest.runFrameSkipTest("Test/nestest.nes", 240, 4);
+    cpuTest.runFrameSkipTest("Test/nestest.nes", 240, 0);
+    cpuTest.runPixelFormatTest("Test/nestest.nes", 60);
+    cpuTest.runIndexedOutputTest("Test/nestest.nes", 60);
+    cpuTest.runFrameTargetTest("Test/nestest.nes", 120);
+    cpuTest.runTripleBufferTest(2000);
+
+    return 0;
+}
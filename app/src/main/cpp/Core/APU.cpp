@@ -97,6 +97,7 @@ void APU::write(u16 addr, u8 data) {
         case 0x4017:
             // Frame counter control (simplesmente reseta contagem para este exemplo)
             frameCounter = 0;
+            frameDiv = 0;
             break;
     }
 }
@@ -186,7 +187,6 @@ void APU::tick() {
 
     // Frame Counter Approximation
     // CPU Clock ~1.789 MHz. Frame Counter 240Hz -> A cada ~7457 ciclos
-    static int frameDiv = 0;
     if (++frameDiv >= 7457) {
         frameDiv = 0;
         frameCounter++;
@@ -75,6 +75,7 @@ private:
 
     // --- Frame Counter & Globals ---
     u32 frameCounter = 0;
+    int frameDiv = 0;
     float sampleAccumulator = 0;
     
     void clockFrameCounter();
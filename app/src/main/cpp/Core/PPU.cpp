@@ -172,7 +172,8 @@ inline void PPU::fetchTiles() {
 
 inline void PPU::emitPixel() {
     if (isRenderingDisabled()) {
-        pixelIndex++;
+        //the backdrop colour, what the NES shows with rendering off
+        drawPixel(outputColors[0]);
         return;
     }
 
@@ -231,17 +232,19 @@ inline void PPU::emitPixel() {
         paletteIndex = 0;
     }
 
-    u8 pindex = ppuread(0x3F00 | (showSprite ? spritePaletteIndex : paletteIndex)) % 64;
-    //Handling grayscale mode
-    u8 p = ppumask.greyScale ? (pindex & 0x30) : pindex;
+    drawPixel(outputColors[showSprite ? spritePaletteIndex : paletteIndex]);
+}
 
+//A pixel into the frame at dot - 2 of the line
+inline void PPU::drawPixel(u32 color) {
     //Dark border rect to hide seam of scroll, and other glitches that may occur
     if (dot <= 9 || dot >= 249 || scanLine <= 7 || scanLine >= 232) {
-        showSprite = false;
-        p = 13;
+        color = borderColor;
     }
 
-    buffer[pixelIndex++] = palette[p];
+    u32 *line = reinterpret_cast<u32 *>(frameRows + (pixelIndex >> 8) * framePitch);
+    line[pixelIndex & 255] = color;
+    pixelIndex++;
 }
 
 inline void PPU::copyHorizontalBits() {
@@ -311,7 +314,13 @@ void PPU::write(u16 address, u8 data) {
         spriteHeight = (data & 0x20) ? 16 : 8;
         ppuctrl.val = data;
     } else if (address == 1) {
+        u8 changed = ppumask.val ^ data;
         ppumask.val = data;
+
+        //greyscale and emphasis, emphasis isn't applied to colours yet
+        if (changed & 0xE1) {
+            updateOutputColors();
+        }
     } else if (address == 2) {
         data &= ~128;
         ppustatus.val &= 128;
@@ -448,6 +457,7 @@ void PPU::ppuwrite(u16 address, u8 data) {
             break;
         case 0x3F00 ... 0x3F0F:
             bg_palette[address - 0x3F00] = data;
+            updateOutputColors();
             break;
         case 0x3F10 ... 0x3F1F:
             if (address == 0x3F10 || address == 0x3F14 || address == 0x3F18 || address == 0x3F1C) {
@@ -456,6 +466,7 @@ void PPU::ppuwrite(u16 address, u8 data) {
                 sprite_palette[address - 0x3F10] = data;
             }
 
+            updateOutputColors();
             break;
         case 0x3000 ... 0x3EFF:
             ppuwrite(address - 0x1000, data);
@@ -465,6 +476,26 @@ void PPU::ppuwrite(u16 address, u8 data) {
     }
 }
 
+//Final colour of every palette RAM index, in the frame buffer's format
+void PPU::updateOutputColors() {
+    for (int i = 0; i < 32; i++) {
+        u8 pindex = ppuread(0x3F00 | i) % 64;
+        //Handling grayscale mode
+        u8 p = ppumask.greyScale ? (pindex & 0x30) : pindex;
+        outputColors[i] = toPixelFormat(palette[p]);
+    }
+
+    borderColor = toPixelFormat(palette[13]);
+}
+
+u32 PPU::toPixelFormat(u32 argb) {
+    if (pixelFormat == PixelFormat::ABGR8888) {
+        return (argb & 0xFF00FF00) | ((argb >> 16) & 0xFF) | ((argb & 0xFF) << 16);
+    }
+
+    return argb;
+}
+
 void PPU::copyOAM(u8 oamEntry, int index) {
     int oamSelect = index / 4;
     int property = index % 4;
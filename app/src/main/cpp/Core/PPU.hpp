@@ -45,9 +45,52 @@ struct SpriteRenderEntity {
     }
 };
 
+//How a frame buffer pixel is laid out in a u32
+enum class PixelFormat {
+    ARGB8888,  //SDL
+    ABGR8888,  //Android bitmaps
+};
+
+//Memory frames are drawn straight into instead of PPU::buffer, like a locked
+//ANativeWindow buffer
+struct FrameTarget {
+    void *pixels;
+    int pitch;  //bytes from one row to the next
+    PixelFormat format;
+};
+
 class PPU : public INESBus {
    public:
-    PPU(Mapper *mapper) : mapper(mapper){};
+    PPU(Mapper *mapper) : mapper(mapper) {
+        ppuctrl.val = 0;
+        ppumask.val = 0;
+        ppustatus.val = 0;
+        updateOutputColors();
+    };
+
+    //Frame buffer pixels are ARGB unless set otherwise
+    void setPixelFormat(PixelFormat format) {
+        pixelFormat = format;
+        updateOutputColors();
+    }
+
+    //Draw into the target, in its pixel format, instead of buffer. Every pixel
+    //of a frame is written. Lines go out as they are drawn, so the target is
+    //swapped once generateFrame is up and before the CPU runs on.
+    void setFrameTarget(const FrameTarget &target) {
+        frameRows = static_cast<u8 *>(target.pixels);
+        framePitch = target.pitch;
+
+        if (target.format != pixelFormat) {
+            setPixelFormat(target.format);
+        }
+    }
+
+    //Back to buffer
+    void clearFrameTarget() {
+        frameRows = reinterpret_cast<u8 *>(buffer);
+        framePitch = 256 * sizeof(u32);
+    }
 
     //cpu address space
     u8 read(u16 address);
@@ -123,18 +166,28 @@ class PPU : public INESBus {
     u8 ppu_read_buffer = 0;
     u8 ppu_read_buffer_cpy = 0;
 
-    // Paleta NES NTSC padrão convertida para 0xAABBGGRR (Android Bitmap Little Endian)
+    // Paleta NES NTSC padrão em ARGB, convertida para o formato de pixel em outputColors
     u32 palette[64] = {
-        0xFF7C7C7C, 0xFFFC0000, 0xFFBC0000, 0xFFBC2844, 0xFF840094, 0xFF2000A8, 0xFF0010A8, 0xFF001488,
-        0xFF003050, 0xFF007800, 0xFF006800, 0xFF005800, 0xFF584000, 0xFF000000, 0xFF000000, 0xFF000000,
-        0xFFBCBCBC, 0xFFF87800, 0xFFF85800, 0xFFE44468, 0xFFCC0094, 0xFF5800E4, 0xFF0038F8, 0xFF105CE4,
-        0xFF007CAC, 0xFF00B800, 0xFF00A800, 0xFF44A800, 0xFF888800, 0xFF000000, 0xFF000000, 0xFF000000,
-        0xFFF8F8F8, 0xFFFCBC3C, 0xFFFC8868, 0xFFF87898, 0xFFF878F8, 0xFF9858F8, 0xFF5878F8, 0xFF44A0FC,
-        0xFF00B8F8, 0xFF18F8B8, 0xFF54D858, 0xFF98F858, 0xFFD8E800, 0xFF787878, 0xFF000000, 0xFF000000,
-        0xFFFCFCFC, 0xFFFCE4A4, 0xFFF8B8B8, 0xFFF8A8D8, 0xFFF8A8F8, 0xFFC0A4F8, 0xFFB0D0F8, 0xFFA8E0FC,
-        0xFF78D8F8, 0xFF78F8D8, 0xFFB8F8B8, 0xFFD8F8B8, 0xFFFCE0B0, 0xFFC0C0C0, 0xFF000000, 0xFF000000
+        0xFF7C7C7C, 0xFF0000FC, 0xFF0000BC, 0xFF4428BC, 0xFF940084, 0xFFA80020, 0xFFA81000, 0xFF881400,
+        0xFF503000, 0xFF007800, 0xFF006800, 0xFF005800, 0xFF004058, 0xFF000000, 0xFF000000, 0xFF000000,
+        0xFFBCBCBC, 0xFF0078F8, 0xFF0058F8, 0xFF6844E4, 0xFF9400CC, 0xFFE40058, 0xFFF83800, 0xFFE45C10,
+        0xFFAC7C00, 0xFF00B800, 0xFF00A800, 0xFF00A844, 0xFF008888, 0xFF000000, 0xFF000000, 0xFF000000,
+        0xFFF8F8F8, 0xFF3CBCFC, 0xFF6888FC, 0xFF9878F8, 0xFFF878F8, 0xFFF85898, 0xFFF87858, 0xFFFCA044,
+        0xFFF8B800, 0xFFB8F818, 0xFF58D854, 0xFF58F898, 0xFF00E8D8, 0xFF787878, 0xFF000000, 0xFF000000,
+        0xFFFCFCFC, 0xFFA4E4FC, 0xFFB8B8F8, 0xFFD8A8F8, 0xFFF8A8F8, 0xFFF8A4C0, 0xFFF8D0B0, 0xFFFCE0A8,
+        0xFFF8D878, 0xFFD8F878, 0xFFB8F8B8, 0xFFB8F8D8, 0xFFB0E0FC, 0xFFC0C0C0, 0xFF000000, 0xFF000000
     };
 
+    //palette RAM resolved to output colours, rebuilt when palette RAM,
+    //greyscale or the pixel format change
+    PixelFormat pixelFormat = PixelFormat::ARGB8888;
+    u32 outputColors[32];
+    u32 borderColor;
+
+    //where frame lines go, buffer unless a frame target is set
+    u8 *frameRows = reinterpret_cast<u8 *>(buffer);
+    int framePitch = 256 * sizeof(u32);
+
     //BG
     u8 bg_palette[16] = {0};
     u8 vram[2048] = {0};
@@ -174,10 +227,13 @@ class PPU : public INESBus {
     bool nmiOccured = false;
 
     //methods
+    void updateOutputColors();
+    u32 toPixelFormat(u32);
     inline void copyHorizontalBits();
     inline void copyVerticalBits();
     inline bool isRenderingDisabled();
     inline void emitPixel();
+    inline void drawPixel(u32);
     inline void fetchTiles();
     inline void xIncrement();
     inline void yIncrement();
@@ -1,7 +1,7 @@
 #include <jni.h>
 #include <string>
 #include <android/log.h>
-#include <android/bitmap.h>
+#include <android/native_window_jni.h>
 #include <cstring>
 #include "Core/6502.hpp"
 #include "Core/Controller.hpp"
@@ -26,6 +26,7 @@ MedNES::PPU* objPpu = nullptr;
 MedNES::Controller* objController = nullptr;
 MedNES::CPU6502* objCpu = nullptr;
 MedNES::APU* objApu = nullptr; 
+ANativeWindow* objWindow = nullptr;
 
 extern "C" JNIEXPORT jboolean JNICALL
 Java_com_mednes_android_MedNESJni_loadRom(JNIEnv* env, jobject, jstring romPath) {
@@ -60,6 +61,7 @@ Java_com_mednes_android_MedNESJni_loadRom(JNIEnv* env, jobject, jstring romPath)
     }
 
     objPpu = new MedNES::PPU(objMapper);
+    objPpu->setPixelFormat(MedNES::PixelFormat::ABGR8888);
     objApu = new MedNES::APU(); 
     objController = new MedNES::Controller();
     
@@ -72,8 +74,32 @@ Java_com_mednes_android_MedNESJni_loadRom(JNIEnv* env, jobject, jstring romPath)
 }
 
 extern "C" JNIEXPORT void JNICALL
-Java_com_mednes_android_MedNESJni_stepFrame(JNIEnv* env, jobject, jobject bitmap) {
+Java_com_mednes_android_MedNESJni_setSurface(JNIEnv* env, jobject, jobject surface) {
+    if (objWindow) {
+        ANativeWindow_release(objWindow);
+        objWindow = nullptr;
+    }
+
+    if (surface) {
+        objWindow = ANativeWindow_fromSurface(env, surface);
+        ANativeWindow_setBuffersGeometry(objWindow, 256, 240, WINDOW_FORMAT_RGBA_8888);
+    }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_mednes_android_MedNESJni_stepFrame(JNIEnv* env, jobject) {
     if (!objCpu || !objPpu) return;
+
+    // O PPU desenha o quadro direto no buffer da janela, sem cópia intermediária.
+    // RGBA_8888 é ABGR8888 em um u32 Little Endian; stride é em pixels.
+    ANativeWindow_Buffer window;
+    bool locked = objWindow && ANativeWindow_lock(objWindow, &window, nullptr) == 0;
+
+    if (locked) {
+        objPpu->setFrameTarget({window.bits, window.stride * (int)sizeof(uint32_t), MedNES::PixelFormat::ABGR8888});
+    } else {
+        objPpu->clearFrameTarget();
+    }
     
     // Executa até completar o frame
     while (!objPpu->generateFrame) { 
@@ -81,15 +107,9 @@ Java_com_mednes_android_MedNESJni_stepFrame(JNIEnv* env, jobject, jobject bitmap
     }
     objPpu->generateFrame = false;
 
-    void* pixels;
-    if (AndroidBitmap_lockPixels(env, bitmap, &pixels) < 0) return;
-    
-    // OTIMIZAÇÃO: Cópia direta de memória (memcpy)
-    // O PPU agora gera o buffer no formato 0xAABBGGRR, que é compatível com
-    // ARGB_8888 em arquiteturas Little Endian (padrão Android).
-    memcpy(pixels, objPpu->buffer, 256 * 240 * sizeof(uint32_t));
-    
-    AndroidBitmap_unlockPixels(env, bitmap);
+    if (locked) {
+        ANativeWindow_unlockAndPost(objWindow);
+    }
 }
 
 extern "C" JNIEXPORT void JNICALL
@@ -1,8 +1,6 @@
 package com.mednes.android
 
 import android.app.Activity
-import android.graphics.Bitmap
-import android.graphics.Paint
 import android.media.AudioAttributes
 import android.media.AudioFormat
 import android.media.AudioManager
@@ -23,7 +21,6 @@ class MainActivity : Activity(), SurfaceHolder.Callback {
     private lateinit var statusText: TextView
     private lateinit var fpsText: TextView
     
-    private var emuBitmap: Bitmap? = null
     private val isRunning = AtomicBoolean(false)
     private var gameThread: Thread? = null
     private var audioThread: Thread? = null 
@@ -67,7 +64,7 @@ class MainActivity : Activity(), SurfaceHolder.Callback {
         if (romFile.exists()) {
             if (MedNESJni.loadRom(romFile.absolutePath)) {
                 statusText.visibility = View.GONE
-                emuBitmap = Bitmap.createBitmap(256, 240, Bitmap.Config.ARGB_8888)
+                MedNESJni.setSurface(holder.surface)
                 startEmulator(holder)
             } else {
                 statusText.text = "Failed to load ROM"
@@ -87,6 +84,7 @@ class MainActivity : Activity(), SurfaceHolder.Callback {
         } catch (e: InterruptedException) {
             e.printStackTrace()
         }
+        MedNESJni.setSurface(null)
     }
 
     private fun startEmulator(holder: SurfaceHolder) {
@@ -158,7 +156,6 @@ class MainActivity : Activity(), SurfaceHolder.Callback {
 
     private fun startGameLoop(holder: SurfaceHolder) {
         gameThread = Thread {
-            val paint = Paint()
             lastFpsTime = System.currentTimeMillis()
             
             // Prioridade máxima para garantir fluidez gráfica
@@ -170,17 +167,10 @@ class MainActivity : Activity(), SurfaceHolder.Callback {
             while (isRunning.get()) {
                 val frameStartNs = System.nanoTime()
 
-                // 1. Executa a emulação (CPU/PPU/APU)
-                MedNESJni.stepFrame(emuBitmap!!)
+                // 1. Executa a emulação (CPU/PPU/APU), o quadro vai direto para a Surface
+                MedNESJni.stepFrame()
 
-                // 2. Desenha na tela
-                val canvas = holder.lockCanvas()
-                if (canvas != null) {
-                    canvas.drawBitmap(emuBitmap!!, 0f, 0f, paint)
-                    holder.unlockCanvasAndPost(canvas)
-                }
-
-                // 3. Contador de FPS
+                // 2. Contador de FPS
                 fpsCounter++
                 val nowMs = System.currentTimeMillis()
                 if (nowMs - lastFpsTime >= 1000) {
@@ -190,7 +180,7 @@ class MainActivity : Activity(), SurfaceHolder.Callback {
                     runOnUiThread { fpsText.text = "FPS: $fps" }
                 }
                 
-                // 4. Limitador de quadros preciso
+                // 3. Limitador de quadros preciso
                 val elapsedNs = System.nanoTime() - frameStartNs
                 nextFrameTimeNs += targetFrameNs
                 var sleepUntilNs = nextFrameTimeNs - System.nanoTime()
@@ -1,9 +1,10 @@
 package com.mednes.android
-import android.graphics.Bitmap
+import android.view.Surface
 object MedNESJni {
     init { System.loadLibrary("mednes") }
     external fun loadRom(path: String): Boolean
-    external fun stepFrame(bitmap: Bitmap)
+    external fun setSurface(surface: Surface?)
+    external fun stepFrame()
     external fun sendInput(keyId: Int, pressed: Boolean)
     // Novo
     external fun getAudioSamples(buffer: ShortArray): Int